@@ -37,22 +37,20 @@ int main()
         pool.invoke(decrement);
     }
 
-    // check value every 500 ms
+    // check value every 500 ms, waiting returns as soon as the last task is finished
     const auto startTs = std::chrono::high_resolution_clock::now();
     size_t lastWorkload = pool.getWorkload();
-    while (pool.getWorkload() && pool.isRunning()) {
+    while (!pool.waitForIdle(std::chrono::milliseconds(500))) {
         const size_t tasksPerSec = (lastWorkload - pool.getWorkload()) * 2;
         std::cout << "value: " << value << ", workload: " << pool.getWorkload() << ", tasks per seconds: ~"
                   << tasksPerSec << std::endl;
         lastWorkload = pool.getWorkload();
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
     }
     const auto endTs = std::chrono::high_resolution_clock::now();
     std::cout << "Finished in: ~" << std::chrono::duration_cast<std::chrono::milliseconds>(endTs - startTs).count()
               << " ms" << std::endl;
 
-    // current thread will be locked until pool finished all remaining tasks
+    // pool is idle, so nothing is left to execute
     pool.interrupt();
 
     std::cout << "value: " << value << std::endl;
@@ -0,0 +1,98 @@
+#include "psi/thread/ThreadPool.h"
+#include "psi/thread/ThreadPoolStealing.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+using namespace psi::thread;
+
+// small piece of cpu work, roughly a few hundred nanoseconds
+void doWork()
+{
+    volatile size_t sink = 0;
+    for (size_t i = 0; i < 200; ++i) {
+        sink = sink + i;
+    }
+}
+
+// N_TASKS independent tasks submitted by main thread
+template <typename Pool>
+double measureFlat(size_t threads, size_t N_TASKS)
+{
+    Pool pool(threads);
+    pool.run();
+
+    std::atomic<size_t> done = 0;
+    const auto startTs = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        pool.invoke([&done]() {
+            doWork();
+            ++done;
+        });
+    }
+    while (done < N_TASKS) {
+        std::this_thread::yield();
+    }
+    const auto endTs = std::chrono::high_resolution_clock::now();
+
+    pool.interrupt();
+    return N_TASKS / std::chrono::duration<double>(endTs - startTs).count();
+}
+
+// binary tree of tasks, every task spawns its children from pool thread
+template <typename Pool>
+double measureNested(size_t threads, size_t DEPTH)
+{
+    Pool pool(threads);
+    pool.run();
+
+    std::atomic<size_t> done = 0;
+    std::function<void(size_t)> spawn = [&](size_t depth) {
+        doWork();
+        if (depth < DEPTH) {
+            pool.invoke([&spawn, depth]() { spawn(depth + 1); });
+            pool.invoke([&spawn, depth]() { spawn(depth + 1); });
+        }
+        ++done;
+    };
+
+    const size_t N_TASKS = (size_t(1) << (DEPTH + 1)) - 1;
+    const auto startTs = std::chrono::high_resolution_clock::now();
+    pool.invoke([&spawn]() { spawn(0); });
+    while (done < N_TASKS) {
+        std::this_thread::yield();
+    }
+    const auto endTs = std::chrono::high_resolution_clock::now();
+
+    pool.interrupt();
+    return N_TASKS / std::chrono::duration<double>(endTs - startTs).count();
+}
+
+int main()
+{
+    const size_t N_TASKS = 500'000;
+    const size_t DEPTH = 18;
+    const size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << std::setw(8) << "threads" << std::setw(18) << "flat global" << std::setw(18) << "flat stealing"
+              << std::setw(18) << "nested global" << std::setw(18) << "nested stealing" << "   (tasks per second)"
+              << std::endl;
+
+    size_t threads = 1;
+    while (true) {
+        const double flatGlobal = measureFlat<ThreadPool>(threads, N_TASKS);
+        const double flatStealing = measureFlat<ThreadPoolStealing>(threads, N_TASKS);
+        const double nestedGlobal = measureNested<ThreadPool>(threads, DEPTH);
+        const double nestedStealing = measureNested<ThreadPoolStealing>(threads, DEPTH);
+
+        std::cout << std::setw(8) << threads << std::fixed << std::setprecision(0) << std::setw(18) << flatGlobal
+                  << std::setw(18) << flatStealing << std::setw(18) << nestedGlobal << std::setw(18) << nestedStealing
+                  << std::endl;
+
+        if (threads == maxThreads) {
+            break;
+        }
+        threads = std::min(threads * 2, maxThreads);
+    }
+}
@@ -0,0 +1,72 @@
+#include "psi/thread/ThreadPool.h"
+#include "psi/thread/ThreadPoolQueued.h"
+#include "psi/thread/ThreadPoolStealing.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+using namespace psi::thread;
+
+struct Result {
+    double submitMs = 0.0;
+    double totalMs = 0.0;
+};
+
+// fan out N_TASKS tiny tasks either one by one or as a single batch
+template <typename Pool>
+Result measure(bool useBatch, size_t N_TASKS)
+{
+    Pool pool(4);
+    pool.run();
+
+    std::atomic<size_t> done = 0;
+    std::vector<ILoop::Func> tasks;
+    tasks.reserve(N_TASKS);
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        tasks.emplace_back([&done]() { ++done; });
+    }
+
+    const auto startTs = std::chrono::high_resolution_clock::now();
+    if (useBatch) {
+        pool.invokeBatch(tasks);
+    } else {
+        for (auto &fn : tasks) {
+            pool.invoke(std::move(fn));
+        }
+    }
+    const auto submittedTs = std::chrono::high_resolution_clock::now();
+    while (done < N_TASKS) {
+        std::this_thread::yield();
+    }
+    const auto endTs = std::chrono::high_resolution_clock::now();
+
+    pool.interrupt();
+
+    using Ms = std::chrono::duration<double, std::milli>;
+    return {Ms(submittedTs - startTs).count(), Ms(endTs - startTs).count()};
+}
+
+template <typename Pool>
+void report(const std::string &name, size_t N_TASKS)
+{
+    const auto single = measure<Pool>(false, N_TASKS);
+    const auto batch = measure<Pool>(true, N_TASKS);
+
+    std::cout << std::setw(20) << name << std::setw(10) << N_TASKS << std::fixed << std::setprecision(2)
+              << std::setw(14) << single.submitMs << std::setw(14) << single.totalMs << std::setw(14) << batch.submitMs
+              << std::setw(14) << batch.totalMs << std::endl;
+}
+
+int main()
+{
+    std::cout << std::setw(20) << "pool" << std::setw(10) << "tasks" << std::setw(14) << "invoke submit"
+              << std::setw(14) << "invoke total" << std::setw(14) << "batch submit" << std::setw(14) << "batch total"
+              << "   (ms)" << std::endl;
+
+    for (size_t N_TASKS : {10'000u, 100'000u}) {
+        report<ThreadPool>("ThreadPool", N_TASKS);
+        report<ThreadPoolQueued>("ThreadPoolQueued", N_TASKS);
+        report<ThreadPoolStealing>("ThreadPoolStealing", N_TASKS);
+    }
+}
@@ -0,0 +1,74 @@
+#include "psi/thread/ThreadPool.h"
+#include "psi/thread/ThreadPoolQueued.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+using namespace psi::thread;
+
+using Clock = std::chrono::high_resolution_clock;
+
+// ping-pong: main thread submits task and waits until pool thread answers, then submits next one.
+// Measured wake-up latency is time between invoke() and start of the task.
+// Spinning policies need a spare core for the pool thread, on single core machine they only add latency.
+std::vector<double> pingPong(ILoop &pool, size_t ROUNDS)
+{
+    std::vector<double> latencies(ROUNDS);
+    std::atomic<bool> pong = false;
+
+    for (size_t i = 0; i < ROUNDS; ++i) {
+        pong = false;
+        const auto submitTs = Clock::now();
+        pool.invoke([&latencies, &pong, submitTs, i]() {
+            latencies[i] = std::chrono::duration<double, std::micro>(Clock::now() - submitTs).count();
+            pong = true;
+        });
+        while (!pong) {
+            cpuRelax();
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+void report(const std::string &name, IdlePolicy policy, const std::vector<double> &latencies)
+{
+    auto percentile = [&latencies](double p) {
+        return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+    };
+
+    std::cout << std::setw(18) << name << std::setw(16) << policy << std::fixed << std::setprecision(2)
+              << std::setw(10) << percentile(0.5) << std::setw(10) << percentile(0.9) << std::setw(10)
+              << percentile(0.99) << std::setw(10) << latencies.back() << std::endl;
+}
+
+int main()
+{
+    const size_t ROUNDS = 20'000;
+
+    std::cout << std::setw(18) << "pool" << std::setw(16) << "idle policy" << std::setw(10) << "p50" << std::setw(10)
+              << "p90" << std::setw(10) << "p99" << std::setw(10) << "max"
+              << "   (wake-up latency, us)" << std::endl;
+
+    for (auto policy : {IdlePolicy::BLOCK, IdlePolicy::SPIN_THEN_PARK, IdlePolicy::BUSY_POLL}) {
+        {
+            ThreadPool::Options options;
+            options.idlePolicy = policy;
+            ThreadPool pool(1, options);
+            pool.run();
+            report("ThreadPool", policy, pingPong(pool, ROUNDS));
+            pool.interrupt();
+        }
+        {
+            ThreadPoolQueued::Options options;
+            options.idlePolicy = policy;
+            ThreadPoolQueued pool(1, options);
+            pool.run();
+            report("ThreadPoolQueued", policy, pingPong(pool, ROUNDS));
+            pool.interrupt();
+        }
+    }
+}
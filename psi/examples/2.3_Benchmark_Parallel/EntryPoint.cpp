@@ -0,0 +1,98 @@
+#include "psi/thread/Parallel.h"
+#include "psi/thread/ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+
+using namespace psi::thread;
+
+template <typename Fn>
+double measureMs(Fn &&fn)
+{
+    const auto startTs = std::chrono::high_resolution_clock::now();
+    fn();
+    const auto endTs = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(endTs - startTs).count();
+}
+
+void report(const std::string &name, double stlMs, double parallelMs)
+{
+    std::cout << std::setw(16) << name << std::fixed << std::setprecision(2) << std::setw(12) << stlMs << std::setw(12)
+              << parallelMs << std::setw(10) << stlMs / parallelMs << "x" << std::endl;
+}
+
+int main()
+{
+    const size_t N = 8'000'000;
+
+    std::vector<double> values(N);
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> distribution(0.0, 1000.0);
+    for (auto &value : values) {
+        value = distribution(random);
+    }
+    std::vector<double> output(N);
+
+    ThreadPool pool(Topology::defaultNumberOfThreads());
+    pool.run();
+
+    std::cout << "threads: " << Topology::defaultNumberOfThreads() << ", elements: " << N << std::endl;
+    std::cout << std::setw(16) << "algorithm" << std::setw(12) << "stl, ms" << std::setw(12) << "psi, ms"
+              << std::setw(11) << "speedup" << std::endl;
+
+    // sum of sqrt is more expensive than memory traffic, so it shows scaling of chunking itself
+    for (auto chunking : {Chunking::STATIC, Chunking::DYNAMIC, Chunking::GUIDED}) {
+        ParallelOptions options;
+        options.chunking = chunking;
+
+        std::ostringstream name;
+        name << "for " << chunking;
+        report(
+            name.str(),
+            measureMs([&]() {
+                for (size_t i = 0; i < N; ++i) {
+                    output[i] = std::sqrt(values[i]);
+                }
+            }),
+            measureMs([&]() {
+                parallel_for(pool, size_t(0), N, [&](size_t i) { output[i] = std::sqrt(values[i]); }, options);
+            }));
+    }
+
+    double sink = 0.0;
+    report(
+        "reduce",
+        measureMs([&]() { sink += std::accumulate(values.begin(), values.end(), 0.0); }),
+        measureMs([&]() { sink += parallel_reduce(pool, values.begin(), values.end(), 0.0); }));
+
+    auto root = [](double value) { return std::sqrt(value); };
+    report(
+        "transform",
+        measureMs([&]() { std::transform(values.begin(), values.end(), output.begin(), root); }),
+        measureMs([&]() { parallel_transform(pool, values.begin(), values.end(), output.begin(), root); }));
+
+    report(
+        "inclusive_scan",
+        measureMs([&]() { std::inclusive_scan(values.begin(), values.end(), output.begin()); }),
+        measureMs([&]() { parallel_inclusive_scan(pool, values.begin(), values.end(), output.begin()); }));
+
+    auto stlSorted = values;
+    auto psiSorted = values;
+    report(
+        "sort",
+        measureMs([&]() { std::sort(stlSorted.begin(), stlSorted.end()); }),
+        measureMs([&]() { parallel_sort(pool, psiSorted.begin(), psiSorted.end()); }));
+
+    pool.interrupt();
+
+    if (stlSorted != psiSorted) {
+        std::cout << "sort results differ!" << std::endl;
+    }
+    std::cout << "(checksum " << sink << ")" << std::endl;
+}
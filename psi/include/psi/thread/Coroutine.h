@@ -0,0 +1,353 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <optional>
+#include <utility>
+
+#include "psi/thread/Future.h"
+#include "psi/thread/ILoop.h"
+
+namespace psi::thread {
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+/// Resumes coroutine when called. If it is destroyed without call (e.g. loop is not running), coroutine is resumed
+/// anyway and its co_await throws std::future_error(broken_promise), so awaiting coroutines do not hang.
+class CoroutineResumer final
+{
+public:
+    CoroutineResumer(std::coroutine_handle<> handle, bool &isDropped)
+        : m_handle(handle)
+        , m_isDropped(&isDropped)
+    {
+    }
+
+    CoroutineResumer(CoroutineResumer &&other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr))
+        , m_isDropped(other.m_isDropped)
+    {
+    }
+
+    ~CoroutineResumer()
+    {
+        if (m_handle) {
+            *m_isDropped = true;
+            m_handle.resume();
+        }
+    }
+
+    void operator()()
+    {
+        std::exchange(m_handle, nullptr).resume();
+    }
+
+private:
+    CoroutineResumer(const CoroutineResumer &) = delete;
+    CoroutineResumer &operator=(const CoroutineResumer &) = delete;
+    CoroutineResumer &operator=(CoroutineResumer &&) = delete;
+
+private:
+    std::coroutine_handle<> m_handle;
+    bool *m_isDropped;
+};
+
+/// Base of awaiters which resume coroutine through a loop
+class ResumeAwaiter
+{
+public:
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_resume() const
+    {
+        if (m_isDropped) {
+            throw std::future_error(std::future_errc::broken_promise);
+        }
+    }
+
+protected:
+    /// Coroutine may be resumed and finished before this returns, awaiter must not be touched afterwards
+    CoroutineResumer makeResumer(std::coroutine_handle<> handle)
+    {
+        return CoroutineResumer(handle, m_isDropped);
+    }
+
+private:
+    bool m_isDropped = false;
+};
+
+class TaskPromiseBase
+{
+    struct FinalAwaiter {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        /// Symmetric transfer to awaiting coroutine: no stack growth for long chains of co_await
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            const auto continuation = handle.promise().m_continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+public:
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception()
+    {
+        m_error = std::current_exception();
+    }
+
+    void setContinuation(std::coroutine_handle<> continuation)
+    {
+        m_continuation = continuation;
+    }
+
+protected:
+    void rethrowIfFailed()
+    {
+        if (m_error) {
+            std::rethrow_exception(m_error);
+        }
+    }
+
+private:
+    std::coroutine_handle<> m_continuation;
+    std::exception_ptr m_error;
+};
+
+template <typename T>
+class TaskPromise final : public TaskPromiseBase
+{
+public:
+    Task<T> get_return_object();
+
+    template <typename U>
+    void return_value(U &&value)
+    {
+        m_value.emplace(std::forward<U>(value));
+    }
+
+    T takeValue()
+    {
+        rethrowIfFailed();
+        return std::move(*m_value);
+    }
+
+private:
+    std::optional<T> m_value;
+};
+
+template <>
+class TaskPromise<void> final : public TaskPromiseBase
+{
+public:
+    Task<void> get_return_object();
+
+    void return_void()
+    {
+    }
+
+    void takeValue()
+    {
+        rethrowIfFailed();
+    }
+};
+
+/// Coroutine which starts immediately and destroys itself when done
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() const noexcept
+        {
+            return {};
+        }
+
+        void return_void() const noexcept
+        {
+        }
+
+        void unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+} // namespace detail
+
+/// Lazily started coroutine: body runs only when Task is awaited, awaiting coroutine is resumed by symmetric transfer
+/// on the thread which finished Task. Exception of body is rethrown by co_await.
+template <typename T>
+class Task final
+{
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+    Task() = default;
+
+    Task(Task &&other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr))
+    {
+    }
+
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other) {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~Task()
+    {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    bool valid() const
+    {
+        return static_cast<bool>(m_handle);
+    }
+
+    auto operator co_await() &&noexcept
+    {
+        struct Awaiter {
+            bool await_ready() const noexcept
+            {
+                return m_handle.done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                m_handle.promise().setContinuation(awaiting);
+                return m_handle;
+            }
+
+            T await_resume()
+            {
+                return m_handle.promise().takeValue();
+            }
+
+            std::coroutine_handle<promise_type> m_handle;
+        };
+
+        return Awaiter {m_handle};
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle)
+        : m_handle(handle)
+    {
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    friend class detail::TaskPromise<T>;
+
+private:
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object()
+{
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+class ScheduleAwaiter final : public ResumeAwaiter
+{
+public:
+    explicit ScheduleAwaiter(ILoop &loop)
+        : m_loop(loop)
+    {
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        m_loop.invoke(makeResumer(handle));
+    }
+
+private:
+    ILoop &m_loop;
+};
+
+template <typename T>
+DetachedTask runDetached(ILoop &loop, Task<T> task, Promise<T> promise)
+{
+    try {
+        co_await ScheduleAwaiter(loop);
+        if constexpr (std::is_void_v<T>) {
+            co_await std::move(task);
+            promise.setValue();
+        } else {
+            promise.setValue(co_await std::move(task));
+        }
+    } catch (...) {
+        promise.setException(std::current_exception());
+    }
+}
+
+} // namespace detail
+
+/// co_await schedule(loop) continues coroutine on a thread of loop.
+/// If loop drops the task (not running), co_await throws std::future_error(broken_promise).
+inline detail::ScheduleAwaiter schedule(ILoop &loop)
+{
+    return detail::ScheduleAwaiter(loop);
+}
+
+/// Starts task on loop, result or exception goes to returned Future
+template <typename T>
+Future<T> spawn(ILoop &loop, Task<T> task)
+{
+    Promise<T> promise;
+    auto future = promise.getFuture();
+    detail::runDetached(loop, std::move(task), std::move(promise));
+    return future;
+}
+
+} // namespace psi::thread
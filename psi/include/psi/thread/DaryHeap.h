@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace psi::thread {
+
+/// Min-heap (by Compare) with Arity children per node over contiguous storage.
+/// Wider nodes make the tree shallower and children of one node share cache lines, so it is cheaper than binary heap
+/// for large element types. Like RingQueue it keeps its storage when drained.
+template <typename T, typename Compare = std::less<T>, size_t Arity = 4u>
+class DaryHeap final
+{
+    static_assert(Arity >= 2u, "heap node should have at least two children");
+
+public:
+    DaryHeap() = default;
+    DaryHeap(DaryHeap &&) noexcept = default;
+    DaryHeap &operator=(DaryHeap &&) noexcept = default;
+
+    template <typename... Args>
+    void emplace(Args &&...args)
+    {
+        m_data.emplace_back(std::forward<Args>(args)...);
+        siftUp(m_data.size() - 1u);
+    }
+
+    void push(T &&value)
+    {
+        emplace(std::move(value));
+    }
+
+    /// The least element, may be moved from before pop()
+    T &top()
+    {
+        return m_data.front();
+    }
+
+    void pop()
+    {
+        if (m_data.size() > 1u) {
+            m_data.front() = std::move(m_data.back());
+        }
+        m_data.pop_back();
+        if (!m_data.empty()) {
+            siftDown(0u);
+        }
+    }
+
+    /// Element at index in heap order, index 0 is top()
+    const T &operator[](size_t index) const
+    {
+        return m_data[index];
+    }
+
+    /// Removes element at index, it may be moved from before
+    void erase(size_t index)
+    {
+        if (index + 1u == m_data.size()) {
+            m_data.pop_back();
+            return;
+        }
+
+        m_data[index] = std::move(m_data.back());
+        m_data.pop_back();
+        if (index && m_compare(m_data[index], m_data[(index - 1u) / Arity])) {
+            siftUp(index);
+        } else {
+            siftDown(index);
+        }
+    }
+
+    size_t size() const
+    {
+        return m_data.size();
+    }
+
+    bool empty() const
+    {
+        return m_data.empty();
+    }
+
+    void clear()
+    {
+        m_data.clear();
+    }
+
+    void reserve(size_t capacity)
+    {
+        m_data.reserve(capacity);
+    }
+
+private:
+    /// element is moved out once and its slot is filled by elements passed over, not swapped at every level
+    void siftUp(size_t index)
+    {
+        T item = std::move(m_data[index]);
+        while (index) {
+            const size_t parent = (index - 1u) / Arity;
+            if (!m_compare(item, m_data[parent])) {
+                break;
+            }
+            m_data[index] = std::move(m_data[parent]);
+            index = parent;
+        }
+        m_data[index] = std::move(item);
+    }
+
+    void siftDown(size_t index)
+    {
+        const size_t size = m_data.size();
+        T item = std::move(m_data[index]);
+        while (true) {
+            const size_t first = index * Arity + 1u;
+            if (first >= size) {
+                break;
+            }
+
+            size_t least = first;
+            const size_t last = first + Arity < size ? first + Arity : size;
+            for (size_t child = first + 1u; child < last; ++child) {
+                if (m_compare(m_data[child], m_data[least])) {
+                    least = child;
+                }
+            }
+            if (!m_compare(m_data[least], item)) {
+                break;
+            }
+            m_data[index] = std::move(m_data[least]);
+            index = least;
+        }
+        m_data[index] = std::move(item);
+    }
+
+    DaryHeap(const DaryHeap &) = delete;
+    DaryHeap &operator=(const DaryHeap &) = delete;
+
+private:
+    std::vector<T> m_data;
+    [[no_unique_address]] Compare m_compare;
+};
+
+} // namespace psi::thread
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <ostream>
+
+namespace psi::thread {
+
+/// How pool with queue per thread picks thread for a new task.
+/// Load of thread is the number of its queued tasks plus tasks it has taken but not finished yet.
+enum class DispatchPolicy
+{
+    /// threads in turn, load is ignored
+    ROUND_ROBIN = 1,
+    /// less loaded of two random threads, constant cost regardless of pool size
+    POWER_OF_TWO_CHOICES,
+    /// the least loaded thread, every invoke reads load of all threads, so it is meant for small pools
+    LEAST_LOADED,
+};
+
+inline std::ostream &operator<<(std::ostream &str, const DispatchPolicy policy)
+{
+    switch (policy) {
+    case DispatchPolicy::ROUND_ROBIN:
+        str << "ROUND_ROBIN";
+        break;
+    case DispatchPolicy::POWER_OF_TWO_CHOICES:
+        str << "POWER_OF_TWO_CHOICES";
+        break;
+    case DispatchPolicy::LEAST_LOADED:
+        str << "LEAST_LOADED";
+        break;
+    }
+    return str;
+}
+
+} // namespace psi::thread
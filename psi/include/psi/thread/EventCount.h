@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace psi::thread {
+
+/// Lets consumers park on arbitrary condition without lost wake-ups and lets producers skip wake-up
+/// (and syscall) when nobody is parked.
+///
+/// Consumer:
+///     const auto key = ec.prepareWait();
+///     if (condition()) { ec.cancelWait(); } else { ec.commitWait(key); }
+/// Producer:
+///     make condition true; ec.notifyOne();
+///
+/// Condition check must be sequentially consistent with producer's update (seq_cst atomics or mutex).
+class EventCount final
+{
+public:
+    using Key = uint32_t;
+
+    Key prepareWait()
+    {
+        m_waiters.fetch_add(1u, std::memory_order_seq_cst);
+        return m_epoch.load(std::memory_order_seq_cst);
+    }
+
+    void cancelWait()
+    {
+        m_waiters.fetch_sub(1u, std::memory_order_seq_cst);
+    }
+
+    void commitWait(Key key)
+    {
+        while (m_epoch.load(std::memory_order_acquire) == key) {
+            m_epoch.wait(key, std::memory_order_acquire);
+        }
+        m_waiters.fetch_sub(1u, std::memory_order_seq_cst);
+    }
+
+    /// Wakes at most count parked consumers
+    void notify(size_t count)
+    {
+        const size_t waiters = m_waiters.load(std::memory_order_seq_cst);
+        if (!waiters || !count) {
+            return;
+        }
+
+        if (count >= waiters) {
+            notifyAll();
+            return;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            m_epoch.fetch_add(1u, std::memory_order_seq_cst);
+            m_epoch.notify_one();
+        }
+    }
+
+    void notifyOne()
+    {
+        if (m_waiters.load(std::memory_order_seq_cst)) {
+            m_epoch.fetch_add(1u, std::memory_order_seq_cst);
+            m_epoch.notify_one();
+        }
+    }
+
+    void notifyAll()
+    {
+        if (m_waiters.load(std::memory_order_seq_cst)) {
+            m_epoch.fetch_add(1u, std::memory_order_seq_cst);
+            m_epoch.notify_all();
+        }
+    }
+
+    size_t waiters() const
+    {
+        return m_waiters.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<Key> m_epoch = 0u;
+    std::atomic<uint32_t> m_waiters = 0u;
+};
+
+} // namespace psi::thread
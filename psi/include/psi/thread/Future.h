@@ -0,0 +1,350 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <future>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "ILoop.h"
+
+namespace psi::thread {
+
+template <typename T>
+class Future;
+
+template <typename T>
+class Promise;
+
+namespace detail {
+
+/// Shared state of Promise and Future, the only allocation made per submitted task.
+/// Continuation is attached by lock-free handshake: whoever of setResult() and setContinuation() comes second
+/// schedules it.
+template <typename T>
+class FutureState final
+{
+    enum Status : uint32_t
+    {
+        HAS_RESULT = 1u,
+        HAS_CONTINUATION = 2u,
+        HAS_WAITER = 4u,
+    };
+
+    static constexpr size_t VALUE_INDEX = 1u;
+    static constexpr size_t ERROR_INDEX = 2u;
+
+public:
+    using Value = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+    void addRef()
+    {
+        m_refs.fetch_add(1u, std::memory_order_relaxed);
+    }
+
+    void release()
+    {
+        if (m_refs.fetch_sub(1u, std::memory_order_acq_rel) == 1u) {
+            delete this;
+        }
+    }
+
+    template <typename... Args>
+    void setValue(Args &&...args)
+    {
+        m_result.template emplace<VALUE_INDEX>(std::forward<Args>(args)...);
+        complete();
+    }
+
+    void setException(std::exception_ptr error)
+    {
+        m_result.template emplace<ERROR_INDEX>(std::move(error));
+        complete();
+    }
+
+    void setContinuation(ILoop &executor, UniqueFunction<void()> &&continuation)
+    {
+        m_executor = &executor;
+        m_continuation = std::move(continuation);
+        if (m_status.fetch_or(HAS_CONTINUATION, std::memory_order_acq_rel) & HAS_RESULT) {
+            schedule();
+        }
+    }
+
+    bool isReady() const
+    {
+        return m_status.load(std::memory_order_acquire) & HAS_RESULT;
+    }
+
+    void wait()
+    {
+        uint32_t status = m_status.load(std::memory_order_acquire);
+        while (!(status & HAS_RESULT)) {
+            if (!(status & HAS_WAITER)) {
+                // producer notifies only if it sees this flag
+                status = m_status.fetch_or(HAS_WAITER, std::memory_order_acq_rel) | HAS_WAITER;
+                continue;
+            }
+            m_status.wait(status, std::memory_order_acquire);
+            status = m_status.load(std::memory_order_acquire);
+        }
+    }
+
+    /// Result must be ready
+    std::exception_ptr exception() const
+    {
+        return m_result.index() == ERROR_INDEX ? std::get<ERROR_INDEX>(m_result) : nullptr;
+    }
+
+    /// Result must be ready, rethrows stored exception
+    Value takeValue()
+    {
+        if (m_result.index() == ERROR_INDEX) {
+            std::rethrow_exception(std::get<ERROR_INDEX>(m_result));
+        }
+        return std::move(std::get<VALUE_INDEX>(m_result));
+    }
+
+private:
+    void complete()
+    {
+        const uint32_t status = m_status.fetch_or(HAS_RESULT, std::memory_order_acq_rel);
+        if (status & HAS_WAITER) {
+            m_status.notify_all();
+        }
+        if (status & HAS_CONTINUATION) {
+            schedule();
+        }
+    }
+
+    void schedule()
+    {
+        // continuation keeps reference to this state, so it is alive until continuation is done.
+        // It is moved out first: executor which drops it must destroy it, otherwise state would own itself.
+        auto continuation = std::move(m_continuation);
+        m_executor->invoke(std::move(continuation));
+    }
+
+private:
+    std::atomic<uint32_t> m_refs = 1u;
+    std::atomic<uint32_t> m_status = 0u;
+    std::variant<std::monostate, Value, std::exception_ptr> m_result;
+    ILoop *m_executor = nullptr;
+    UniqueFunction<void()> m_continuation;
+};
+
+template <typename Fn, typename T>
+struct ContinuationResult {
+    using type = std::invoke_result_t<Fn &, T>;
+};
+
+template <typename Fn>
+struct ContinuationResult<Fn, void> {
+    using type = std::invoke_result_t<Fn &>;
+};
+
+} // namespace detail
+
+/// Producer side of Future. If destroyed without result, Future gets std::future_error(broken_promise),
+/// e.g. when task is dropped by interruptImmediately().
+template <typename T>
+class Promise final
+{
+public:
+    Promise()
+        : m_state(new detail::FutureState<T>())
+    {
+    }
+
+    Promise(Promise &&other) noexcept
+        : m_state(std::exchange(other.m_state, nullptr))
+        , m_isSatisfied(std::exchange(other.m_isSatisfied, false))
+    {
+    }
+
+    Promise &operator=(Promise &&other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            m_state = std::exchange(other.m_state, nullptr);
+            m_isSatisfied = std::exchange(other.m_isSatisfied, false);
+        }
+        return *this;
+    }
+
+    ~Promise()
+    {
+        reset();
+    }
+
+    /// Must be called once
+    Future<T> getFuture()
+    {
+        m_state->addRef();
+        return Future<T>(m_state);
+    }
+
+    template <typename... Args>
+    void setValue(Args &&...args)
+    {
+        m_isSatisfied = true;
+        m_state->setValue(std::forward<Args>(args)...);
+    }
+
+    void setException(std::exception_ptr error)
+    {
+        m_isSatisfied = true;
+        m_state->setException(std::move(error));
+    }
+
+    /// Sets result of fn(args...) or exception thrown by it
+    template <typename Fn, typename... Args>
+    void setWith(Fn &&fn, Args &&...args)
+    {
+        try {
+            if constexpr (std::is_void_v<T>) {
+                std::forward<Fn>(fn)(std::forward<Args>(args)...);
+                setValue();
+            } else {
+                setValue(std::forward<Fn>(fn)(std::forward<Args>(args)...));
+            }
+        } catch (...) {
+            setException(std::current_exception());
+        }
+    }
+
+private:
+    void reset()
+    {
+        if (!m_state) {
+            return;
+        }
+
+        if (!m_isSatisfied) {
+            setException(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+        }
+        std::exchange(m_state, nullptr)->release();
+    }
+
+    Promise(const Promise &) = delete;
+    Promise &operator=(const Promise &) = delete;
+
+private:
+    detail::FutureState<T> *m_state;
+    bool m_isSatisfied = false;
+};
+
+/// Result of task given to submit(). Unlike std::future, waiting thread is woken only if it really waits,
+/// and continuation is invoked on executor directly.
+template <typename T>
+class Future final
+{
+public:
+    Future() = default;
+
+    Future(Future &&other) noexcept
+        : m_state(std::exchange(other.m_state, nullptr))
+    {
+    }
+
+    Future &operator=(Future &&other) noexcept
+    {
+        if (this != &other) {
+            if (m_state) {
+                m_state->release();
+            }
+            m_state = std::exchange(other.m_state, nullptr);
+        }
+        return *this;
+    }
+
+    ~Future()
+    {
+        if (m_state) {
+            m_state->release();
+        }
+    }
+
+    bool valid() const
+    {
+        return m_state != nullptr;
+    }
+
+    bool isReady() const
+    {
+        return m_state->isReady();
+    }
+
+    void wait() const
+    {
+        m_state->wait();
+    }
+
+    /// Blocks until result is ready, rethrows exception of task. Future is invalid afterwards.
+    T get()
+    {
+        Future holder(std::move(*this));
+        holder.m_state->wait();
+        if constexpr (std::is_void_v<T>) {
+            holder.m_state->takeValue();
+        } else {
+            return holder.m_state->takeValue();
+        }
+    }
+
+    /// Invokes fn(value) on executor once result is ready. Exception of this future skips fn and goes
+    /// to returned future. Future is invalid afterwards.
+    template <typename Fn>
+    auto then(Fn &&fn, ILoop &executor) -> Future<typename detail::ContinuationResult<std::decay_t<Fn>, T>::type>
+    {
+        using Result = typename detail::ContinuationResult<std::decay_t<Fn>, T>::type;
+
+        Promise<Result> promise;
+        auto future = promise.getFuture();
+
+        auto *state = m_state;
+        state->setContinuation(executor,
+                               [parent = std::move(*this), promise = std::move(promise),
+                                fn = std::forward<Fn>(fn)]() mutable {
+                                   if (auto error = parent.m_state->exception()) {
+                                       promise.setException(std::move(error));
+                                   } else if constexpr (std::is_void_v<T>) {
+                                       promise.setWith(fn);
+                                   } else {
+                                       promise.setWith(fn, parent.m_state->takeValue());
+                                   }
+                               });
+
+        return future;
+    }
+
+private:
+    explicit Future(detail::FutureState<T> *state)
+        : m_state(state)
+    {
+    }
+
+    Future(const Future &) = delete;
+    Future &operator=(const Future &) = delete;
+
+    friend class Promise<T>;
+
+private:
+    detail::FutureState<T> *m_state = nullptr;
+};
+
+/// Invokes fn on loop, returns its result. Small callables are kept in task's inline buffer,
+/// so shared state is the only allocation.
+template <typename Fn>
+auto submit(ILoop &loop, Fn &&fn) -> Future<std::invoke_result_t<std::decay_t<Fn> &>>
+{
+    using Result = std::invoke_result_t<std::decay_t<Fn> &>;
+
+    Promise<Result> promise;
+    auto future = promise.getFuture();
+    loop.invoke([promise = std::move(promise), fn = std::forward<Fn>(fn)]() mutable { promise.setWith(fn); });
+    return future;
+}
+
+} // namespace psi::thread
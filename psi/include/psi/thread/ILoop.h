@@ -1,17 +1,26 @@
 #pragma once
 
-#include <functional>
+#include <span>
+
+#include "psi/thread/UniqueFunction.h"
 
 namespace psi::thread {
 
 class ILoop
 {
 public:
-    using Func = std::function<void()>;
+    using Func = UniqueFunction<void()>;
     virtual ~ILoop() = default;
 
     virtual void run() = 0;
     virtual void invoke(Func &&) = 0;
+    /// Tasks are moved out of the span
+    virtual void invokeBatch(std::span<Func> tasks)
+    {
+        for (auto &fn : tasks) {
+            invoke(std::move(fn));
+        }
+    }
     virtual void interrupt() = 0;
     virtual void interruptImmediately() = 0;
     virtual bool isRunning() = 0;
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <sstream>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace psi::thread {
+
+/// What pool thread does when its queue is empty
+enum class IdlePolicy
+{
+    /// park on condition variable at once
+    BLOCK = 1,
+    /// spin for a while (cpu pause, then yield), park if nothing came
+    SPIN_THEN_PARK,
+    /// never park, keeps core busy. Only for latency-critical pools pinned to isolated cores.
+    BUSY_POLL,
+};
+
+inline std::ostream &operator<<(std::ostream &str, const IdlePolicy policy)
+{
+    switch (policy) {
+    case IdlePolicy::BLOCK:
+        str << "BLOCK";
+        break;
+    case IdlePolicy::SPIN_THEN_PARK:
+        str << "SPIN_THEN_PARK";
+        break;
+    case IdlePolicy::BUSY_POLL:
+        str << "BUSY_POLL";
+        break;
+    }
+    return str;
+}
+
+inline void cpuRelax()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+/// Spins until predicate is satisfied.
+/// SPIN_THEN_PARK: exponential cpu pause backoff for the first half of spinLimit iterations, yield for the rest,
+/// returns false if spinLimit is exhausted.
+/// BUSY_POLL: short cpu pauses only, never gives up.
+/// BLOCK: does not spin at all.
+template <typename Predicate>
+bool spinUntil(IdlePolicy policy, size_t spinLimit, Predicate &&predicate)
+{
+    const size_t MAX_PAUSES = 64u;
+
+    if (policy == IdlePolicy::BLOCK) {
+        return predicate();
+    }
+
+    size_t pauses = 1u;
+    for (size_t i = 0; policy == IdlePolicy::BUSY_POLL || i < spinLimit; ++i) {
+        if (predicate()) {
+            return true;
+        }
+
+        if (policy == IdlePolicy::BUSY_POLL || i < spinLimit / 2) {
+            for (size_t p = 0; p < pauses; ++p) {
+                cpuRelax();
+            }
+            if (policy == IdlePolicy::SPIN_THEN_PARK && pauses < MAX_PAUSES) {
+                pauses *= 2;
+            }
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    return predicate();
+}
+
+} // namespace psi::thread
@@ -10,6 +10,7 @@ enum class LoopStrategy
     ASYNC_LOOP = 1,
     THREAD_POOL,
     THREAD_POOL_QUEUED,
+    THREAD_POOL_STEALING,
 };
 
 inline std::ostream &operator<<(std::ostream &str, const LoopStrategy strat)
@@ -24,6 +25,9 @@ inline std::ostream &operator<<(std::ostream &str, const LoopStrategy strat)
     case LoopStrategy::THREAD_POOL_QUEUED:
         str << "THREAD_POOL_QUEUED";
         break;
+    case LoopStrategy::THREAD_POOL_STEALING:
+        str << "THREAD_POOL_STEALING";
+        break;
     }
     return str;
 }
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace psi::thread {
+
+/// Bounded lock-free multi-producer multi-consumer queue (D. Vyukov).
+/// Every slot carries a sequence number, so producers and consumers only compete on their own end.
+/// Capacity is rounded up to power of two.
+template <typename T>
+class MpmcQueue final
+{
+    static constexpr size_t CACHE_LINE_SIZE = 64u;
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *value()
+        {
+            return std::launder(reinterpret_cast<T *>(storage));
+        }
+    };
+
+public:
+    explicit MpmcQueue(size_t capacity)
+        : m_capacity(roundUp(capacity))
+        , m_mask(m_capacity - 1)
+        , m_cells(new Cell[m_capacity])
+        , m_enqueuePos(0)
+        , m_dequeuePos(0)
+    {
+        for (size_t i = 0; i < m_capacity; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~MpmcQueue()
+    {
+        const size_t end = m_enqueuePos.load(std::memory_order_relaxed);
+        for (size_t pos = m_dequeuePos.load(std::memory_order_relaxed); pos != end; ++pos) {
+            m_cells[pos & m_mask].value()->~T();
+        }
+    }
+
+    /// Returns false if queue is full, value is left untouched in that case
+    template <typename U>
+    bool tryPush(U &&value)
+    {
+        Cell *cell = nullptr;
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &m_cells[pos & m_mask];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (cell->storage) T(std::forward<U>(value));
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Returns false if queue is empty
+    bool tryPop(T &value)
+    {
+        Cell *cell = nullptr;
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &m_cells[pos & m_mask];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = std::move(*cell->value());
+        cell->value()->~T();
+        cell->sequence.store(pos + m_capacity, std::memory_order_release);
+        return true;
+    }
+
+    /// Approximate when called concurrently
+    size_t size() const
+    {
+        const size_t dequeuePos = m_dequeuePos.load(std::memory_order_seq_cst);
+        const size_t enqueuePos = m_enqueuePos.load(std::memory_order_seq_cst);
+        return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0u;
+    }
+
+    bool empty() const
+    {
+        return size() == 0u;
+    }
+
+    size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+private:
+    static size_t roundUp(size_t capacity)
+    {
+        size_t result = 2u;
+        while (result < capacity) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    MpmcQueue(const MpmcQueue &) = delete;
+    MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+private:
+    const size_t m_capacity;
+    const size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_enqueuePos;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_dequeuePos;
+};
+
+} // namespace psi::thread
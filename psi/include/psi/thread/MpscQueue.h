@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace psi::thread {
+
+/// Unbounded lock-free multi-producer single-consumer queue (D. Vyukov), linked list of nodes.
+/// push() is one allocation and one atomic exchange, producers never wait for each other or for consumer.
+/// Producer and consumer ends are on separate cache lines.
+/// Producer which has done the exchange but not linked its node yet hides nodes pushed after it, tryPop() returns
+/// false meanwhile, so consumer has to retry if it knows the queue is not empty.
+/// IsSingleProducer (see SpscQueue) replaces the exchange by plain store for queue with one known producer.
+template <typename T, bool IsSingleProducer = false>
+class MpscQueue final
+{
+    static constexpr size_t CACHE_LINE_SIZE = 64u;
+
+    struct Node {
+        std::atomic<Node *> next = nullptr;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *value()
+        {
+            return std::launder(reinterpret_cast<T *>(storage));
+        }
+    };
+
+    using Tail = std::conditional_t<IsSingleProducer, Node *, std::atomic<Node *>>;
+
+public:
+    MpscQueue()
+        : m_tail(new Node)
+        , m_head(tail())
+    {
+    }
+
+    ~MpscQueue()
+    {
+        // the head node is a consumed one, its value is destroyed already
+        while (Node *next = m_head->next.load(std::memory_order_acquire)) {
+            next->value()->~T();
+            delete m_head;
+            m_head = next;
+        }
+        delete m_head;
+    }
+
+    /// Producer side
+    template <typename U>
+    void push(U &&value)
+    {
+        Node *node = new Node;
+        new (node->storage) T(std::forward<U>(value));
+        if constexpr (IsSingleProducer) {
+            m_tail->next.store(node, std::memory_order_release);
+            m_tail = node;
+        } else {
+            m_tail.exchange(node, std::memory_order_acq_rel)->next.store(node, std::memory_order_release);
+        }
+    }
+
+    /// Consumer side, returns false if queue is empty
+    bool tryPop(T &value)
+    {
+        Node *next = m_head->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+
+        // next becomes the head, its value is moved out and destroyed
+        value = std::move(*next->value());
+        next->value()->~T();
+        delete m_head;
+        m_head = next;
+        return true;
+    }
+
+    /// Consumer side
+    bool empty() const
+    {
+        return !m_head->next.load(std::memory_order_acquire);
+    }
+
+private:
+    Node *tail() const
+    {
+        if constexpr (IsSingleProducer) {
+            return m_tail;
+        } else {
+            return m_tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+private:
+    alignas(CACHE_LINE_SIZE) Tail m_tail;
+    alignas(CACHE_LINE_SIZE) Node *m_head;
+};
+
+/// Lock-free queue for one producer and one consumer, push() has no atomic read-modify-write
+template <typename T>
+using SpscQueue = MpscQueue<T, true>;
+
+} // namespace psi::thread
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "psi/thread/ILoop.h"
+#include "psi/thread/ThreadPool.h"
+#include "psi/thread/Topology.h"
+
+namespace psi::thread {
+
+/// One ThreadPool shard per NUMA node, threads of shard are pinned to CPUs of its node.
+/// Task goes to shard of the node submitting thread runs on, so work spawned by pool threads stays node-local.
+/// Tasks from threads with unknown node are spread round-robin.
+class NumaThreadPool : public ILoop
+{
+public:
+    struct Options {
+        /// threads per shard, 0 means node's available CPUs (within cgroup CPU quota)
+        size_t threadsPerNode = 0u;
+        /// options of every shard, cpuSets are replaced by CPUs of shard's node
+        ThreadPool::Options poolOptions;
+    };
+
+    NumaThreadPool();
+    NumaThreadPool(const Options &);
+    NumaThreadPool(std::vector<NumaNode> nodes, const Options &);
+    virtual ~NumaThreadPool();
+
+    /// node is index in getNodes()
+    void invoke(Func &&, size_t node);
+    const std::vector<NumaNode> &getNodes() const;
+    size_t getWorkload(size_t node) const;
+
+    /// Like invoke(), but gives back result or exception of fn
+    template <typename Fn>
+    auto submit(Fn &&fn)
+    {
+        return psi::thread::submit(*this, std::forward<Fn>(fn));
+    }
+
+    /// co_await pool.schedule() continues coroutine on a thread of pool
+    auto schedule()
+    {
+        return psi::thread::schedule(*this);
+    }
+
+public: /// implements ILoop
+    void run() override;
+    void invoke(Func &&) override;
+    void invokeBatch(std::span<Func>) override;
+    void interrupt() override;
+    void interruptImmediately() override;
+    bool isRunning() override;
+    size_t getWorkload() const override;
+    void join() override;
+
+private:
+    size_t selectShard();
+
+private:
+    std::vector<NumaNode> m_nodes;
+    std::vector<std::unique_ptr<ThreadPool>> m_shards;
+    std::atomic<size_t> m_nextShard = 0;
+};
+
+} // namespace psi::thread
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <ostream>
+
+namespace psi::thread {
+
+/// What invoke() does when bounded queue of pool is full.
+/// Every task which is not queued because of overflow is counted as rejected.
+enum class OverflowPolicy
+{
+    /// producer waits until consumers free some space or pool is stopped
+    BLOCK = 1,
+    /// new task is dropped
+    REJECT,
+    /// the oldest queued task is dropped to make room for new one
+    DROP_OLDEST,
+    /// new task is executed by producer itself
+    CALLER_RUNS,
+};
+
+inline std::ostream &operator<<(std::ostream &str, const OverflowPolicy policy)
+{
+    switch (policy) {
+    case OverflowPolicy::BLOCK:
+        str << "BLOCK";
+        break;
+    case OverflowPolicy::REJECT:
+        str << "REJECT";
+        break;
+    case OverflowPolicy::DROP_OLDEST:
+        str << "DROP_OLDEST";
+        break;
+    case OverflowPolicy::CALLER_RUNS:
+        str << "CALLER_RUNS";
+        break;
+    }
+    return str;
+}
+
+} // namespace psi::thread
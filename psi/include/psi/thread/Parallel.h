@@ -0,0 +1,504 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "ILoop.h"
+#include "Topology.h"
+
+namespace psi::thread {
+
+/// How range is split between workers
+enum class Chunking
+{
+    /// one equal chunk per worker, lowest overhead for uniform work
+    STATIC = 1,
+    /// chunks of grain size taken one by one, balances irregular work
+    DYNAMIC,
+    /// chunks shrink from remaining / (2 * workers) down to grain size
+    GUIDED,
+};
+
+inline std::ostream &operator<<(std::ostream &str, const Chunking chunking)
+{
+    switch (chunking) {
+    case Chunking::STATIC:
+        str << "STATIC";
+        break;
+    case Chunking::DYNAMIC:
+        str << "DYNAMIC";
+        break;
+    case Chunking::GUIDED:
+        str << "GUIDED";
+        break;
+    }
+    return str;
+}
+
+struct ParallelOptions {
+    Chunking chunking = Chunking::STATIC;
+    /// min number of elements per chunk, 0 means chosen by range size
+    size_t grainSize = 0u;
+    /// number of workers including caller, 0 means Topology::defaultNumberOfThreads()
+    size_t concurrency = 0u;
+    /// caller executes chunks as well instead of sleeping until loop's threads finish them.
+    /// Must be true if caller is thread of the same loop, otherwise it may wait for itself.
+    bool callerParticipates = true;
+};
+
+namespace detail {
+
+inline size_t resolveConcurrency(const ParallelOptions &options)
+{
+    return std::max<size_t>(options.concurrency ? options.concurrency : Topology::defaultNumberOfThreads(), 1u);
+}
+
+class ChunkSource;
+
+/// Chunks of [0, size) shared by caller and helper tasks.
+/// Helper which starts after all chunks are claimed does not touch caller's data, so it may outlive the call.
+class ParallelRange final
+{
+public:
+    using WorkerFn = void (*)(void *, ChunkSource &);
+
+    ParallelRange(size_t size, size_t workers, const ParallelOptions &options)
+        : m_size(size)
+        , m_workers(workers)
+        , m_chunking(options.chunking)
+        , m_grainSize(options.grainSize ? options.grainSize : std::max<size_t>(size / (workers * 8u), 1u))
+        , m_chunkSize(m_chunking == Chunking::STATIC ? std::max((size + workers - 1) / workers, m_grainSize)
+                                                     : m_grainSize)
+    {
+    }
+
+    size_t maxChunks() const
+    {
+        return (m_size + m_chunkSize - 1) / m_chunkSize;
+    }
+
+    void setWorker(void *worker, WorkerFn workerFn)
+    {
+        m_worker = worker;
+        m_workerFn = workerFn;
+    }
+
+    void setHelpers(size_t helpers)
+    {
+        m_aliveHelpers.store(helpers, std::memory_order_relaxed);
+    }
+
+    bool claim(size_t &begin, size_t &end)
+    {
+        if (m_chunking == Chunking::GUIDED) {
+            size_t current = m_next.load(std::memory_order_relaxed);
+            while (current < m_size) {
+                const size_t chunk = std::max(m_grainSize, (m_size - current) / (2u * m_workers));
+                if (m_next.compare_exchange_weak(current, current + chunk, std::memory_order_relaxed)) {
+                    begin = current;
+                    end = std::min(current + chunk, m_size);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        begin = m_next.fetch_add(m_chunkSize, std::memory_order_relaxed);
+        if (begin >= m_size) {
+            return false;
+        }
+        end = std::min(begin + m_chunkSize, m_size);
+        return true;
+    }
+
+    void complete(size_t count)
+    {
+        if (count && m_completed.fetch_add(count, std::memory_order_acq_rel) + count == m_size) {
+            signal();
+        }
+    }
+
+    /// Keeps first error, chunks not claimed yet are skipped
+    void fail(std::exception_ptr error)
+    {
+        if (!m_hasError.exchange(true, std::memory_order_acq_rel)) {
+            m_error = std::move(error);
+        }
+
+        const size_t claimed = m_next.exchange(m_size, std::memory_order_relaxed);
+        if (claimed < m_size) {
+            complete(m_size - claimed);
+        }
+    }
+
+    /// Executes chunks until none left
+    void work();
+
+    void onHelperDone()
+    {
+        if (m_aliveHelpers.fetch_sub(1u, std::memory_order_acq_rel) == 1u) {
+            signal();
+        }
+    }
+
+    /// Returns when all chunks are done or all helpers are gone (some of them could be dropped by loop)
+    void wait()
+    {
+        while (true) {
+            const uint32_t signal = m_signal.load(std::memory_order_acquire);
+            if (isCompleted() || !m_aliveHelpers.load(std::memory_order_acquire)) {
+                return;
+            }
+            m_signal.wait(signal, std::memory_order_acquire);
+        }
+    }
+
+    bool isCompleted() const
+    {
+        return m_completed.load(std::memory_order_acquire) == m_size;
+    }
+
+    void rethrowIfFailed()
+    {
+        if (m_hasError.load(std::memory_order_acquire)) {
+            std::rethrow_exception(m_error);
+        }
+    }
+
+private:
+    void signal()
+    {
+        m_signal.fetch_add(1u, std::memory_order_release);
+        m_signal.notify_all();
+    }
+
+private:
+    const size_t m_size;
+    const size_t m_workers;
+    const Chunking m_chunking;
+    const size_t m_grainSize;
+    const size_t m_chunkSize;
+    alignas(64) std::atomic<size_t> m_next = 0u;
+    alignas(64) std::atomic<size_t> m_completed = 0u;
+    std::atomic<size_t> m_aliveHelpers = 0u;
+    std::atomic<uint32_t> m_signal = 0u;
+    std::atomic<bool> m_hasError = false;
+    std::exception_ptr m_error;
+    void *m_worker = nullptr;
+    WorkerFn m_workerFn = nullptr;
+};
+
+/// Chunks claimed by one worker. Chunk is reported as completed only when the next one is claimed
+/// or worker returns, so caller is not released while worker still uses its data.
+class ChunkSource final
+{
+public:
+    ChunkSource(ParallelRange &range, size_t begin, size_t end)
+        : m_range(range)
+        , m_begin(begin)
+        , m_end(end)
+    {
+    }
+
+    bool next(size_t &begin, size_t &end)
+    {
+        if (m_isFirst) {
+            m_isFirst = false;
+        } else {
+            size_t nextBegin = 0u;
+            size_t nextEnd = 0u;
+            if (!m_range.claim(nextBegin, nextEnd)) {
+                return false;
+            }
+            m_range.complete(m_end - m_begin);
+            m_begin = nextBegin;
+            m_end = nextEnd;
+        }
+
+        begin = m_begin;
+        end = m_end;
+        return true;
+    }
+
+    size_t pending() const
+    {
+        return m_end - m_begin;
+    }
+
+private:
+    ParallelRange &m_range;
+    size_t m_begin;
+    size_t m_end;
+    bool m_isFirst = true;
+};
+
+inline void ParallelRange::work()
+{
+    size_t begin = 0u;
+    size_t end = 0u;
+    if (!claim(begin, end)) {
+        return;
+    }
+
+    ChunkSource source(*this, begin, end);
+    try {
+        m_workerFn(m_worker, source);
+    } catch (...) {
+        fail(std::current_exception());
+    }
+    complete(source.pending());
+}
+
+/// Task given to loop, reports to range when it is done or dropped by loop
+class ParallelHelper final
+{
+public:
+    explicit ParallelHelper(std::shared_ptr<ParallelRange> range)
+        : m_range(std::move(range))
+    {
+    }
+
+    ParallelHelper(ParallelHelper &&) noexcept = default;
+
+    ~ParallelHelper()
+    {
+        if (m_range) {
+            m_range->onHelperDone();
+        }
+    }
+
+    void operator()()
+    {
+        m_range->work();
+    }
+
+private:
+    std::shared_ptr<ParallelRange> m_range;
+};
+
+/// Calls worker(ChunkSource &) on up to concurrency threads (caller included) until [0, size) is done
+template <typename Worker>
+void runParallel(ILoop &loop, size_t size, const ParallelOptions &options, Worker &worker)
+{
+    if (!size) {
+        return;
+    }
+
+    const size_t workers = resolveConcurrency(options);
+    auto range = std::make_shared<ParallelRange>(size, workers, options);
+    range->setWorker(&worker, [](void *ptr, ChunkSource &source) { (*static_cast<Worker *>(ptr))(source); });
+
+    const size_t callerShare = options.callerParticipates ? 1u : 0u;
+    const size_t helpers = std::min(workers, range->maxChunks()) - callerShare;
+    range->setHelpers(helpers);
+    for (size_t i = 0; i < helpers; ++i) {
+        loop.invoke(ParallelHelper(range));
+    }
+
+    if (options.callerParticipates) {
+        range->work();
+    }
+    range->wait();
+
+    if (!range->isCompleted()) {
+        // helpers are gone, but chunks are left: loop is not running
+        range->work();
+        range->wait();
+    }
+
+    range->rethrowIfFailed();
+}
+
+} // namespace detail
+
+/// Calls fn(i) for every i in [first, last)
+template <typename Index, typename Fn>
+void parallel_for(ILoop &loop, Index first, Index last, Fn &&fn, const ParallelOptions &options = {})
+{
+    if (!(first < last)) {
+        return;
+    }
+
+    auto worker = [first, &fn](detail::ChunkSource &source) {
+        size_t begin = 0u;
+        size_t end = 0u;
+        while (source.next(begin, end)) {
+            for (size_t i = begin; i < end; ++i) {
+                fn(static_cast<Index>(first + static_cast<Index>(i)));
+            }
+        }
+    };
+    detail::runParallel(loop, static_cast<size_t>(last - first), options, worker);
+}
+
+/// Reduces [first, last) with op starting from init. op must be associative and commutative.
+template <typename RandomIt, typename T, typename BinaryOp = std::plus<>>
+T parallel_reduce(
+    ILoop &loop, RandomIt first, RandomIt last, T init, BinaryOp op = {}, const ParallelOptions &options = {})
+{
+    std::mutex mutex;
+    T result = std::move(init);
+
+    auto worker = [first, &op, &mutex, &result](detail::ChunkSource &source) {
+        size_t begin = 0u;
+        size_t end = 0u;
+        if (!source.next(begin, end)) {
+            return;
+        }
+
+        T partial = first[begin];
+        ++begin;
+        do {
+            for (size_t i = begin; i < end; ++i) {
+                partial = op(std::move(partial), first[i]);
+            }
+        } while (source.next(begin, end));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        result = op(std::move(result), std::move(partial));
+    };
+    detail::runParallel(loop, static_cast<size_t>(std::distance(first, last)), options, worker);
+
+    return result;
+}
+
+/// Writes op(*it) for every it in [first, last) to range starting from dFirst, returns end of written range
+template <typename RandomIt, typename OutputIt, typename UnaryOp>
+OutputIt parallel_transform(
+    ILoop &loop, RandomIt first, RandomIt last, OutputIt dFirst, UnaryOp op, const ParallelOptions &options = {})
+{
+    const size_t size = static_cast<size_t>(std::distance(first, last));
+
+    auto worker = [first, dFirst, &op](detail::ChunkSource &source) {
+        size_t begin = 0u;
+        size_t end = 0u;
+        while (source.next(begin, end)) {
+            for (size_t i = begin; i < end; ++i) {
+                dFirst[i] = op(first[i]);
+            }
+        }
+    };
+    detail::runParallel(loop, size, options, worker);
+
+    return dFirst + size;
+}
+
+/// Sorts blocks in parallel, then merges them pairwise in parallel rounds.
+/// grainSize is min block size (default 2048), chunking option is not used.
+template <typename RandomIt, typename Compare = std::less<>>
+void parallel_sort(ILoop &loop, RandomIt first, RandomIt last, Compare comp = {}, const ParallelOptions &options = {})
+{
+    const size_t size = static_cast<size_t>(std::distance(first, last));
+    const size_t minBlockSize = options.grainSize ? options.grainSize : 2048u;
+    const size_t blocks = std::min(detail::resolveConcurrency(options), std::max<size_t>(size / minBlockSize, 1u));
+    if (blocks < 2u) {
+        std::sort(first, last, comp);
+        return;
+    }
+
+    ParallelOptions blockOptions = options;
+    blockOptions.chunking = Chunking::DYNAMIC;
+    blockOptions.grainSize = 1u;
+
+    const size_t blockSize = (size + blocks - 1) / blocks;
+    parallel_for(
+        loop,
+        size_t(0),
+        blocks,
+        [&](size_t block) {
+            std::sort(first + block * blockSize, first + std::min(size, (block + 1) * blockSize), comp);
+        },
+        blockOptions);
+
+    for (size_t width = blockSize; width < size; width *= 2u) {
+        const size_t pairs = (size + 2u * width - 1) / (2u * width);
+        parallel_for(
+            loop,
+            size_t(0),
+            pairs,
+            [&](size_t pair) {
+                const size_t low = pair * 2u * width;
+                const size_t middle = std::min(low + width, size);
+                const size_t high = std::min(low + 2u * width, size);
+                if (middle < high) {
+                    std::inplace_merge(first + low, first + middle, first + high, comp);
+                }
+            },
+            blockOptions);
+    }
+}
+
+/// Inclusive prefix scan of [first, last) to range starting from dFirst (may be equal to first),
+/// returns end of written range. op must be associative.
+/// Two passes over blocks: local scans, then carry of previous blocks is applied. chunking option is not used.
+template <typename RandomIt, typename OutputIt, typename BinaryOp = std::plus<>>
+OutputIt parallel_inclusive_scan(
+    ILoop &loop, RandomIt first, RandomIt last, OutputIt dFirst, BinaryOp op = {}, const ParallelOptions &options = {})
+{
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+
+    const size_t size = static_cast<size_t>(std::distance(first, last));
+    const size_t minBlockSize = options.grainSize ? options.grainSize : 4096u;
+    const size_t maxBlocks = std::min(detail::resolveConcurrency(options), std::max<size_t>(size / minBlockSize, 1u));
+    if (maxBlocks < 2u) {
+        return std::inclusive_scan(first, last, dFirst, op);
+    }
+
+    ParallelOptions blockOptions = options;
+    blockOptions.chunking = Chunking::DYNAMIC;
+    blockOptions.grainSize = 1u;
+
+    // rounded up block size may leave fewer non-empty blocks than requested (e.g. 9 elements in 4 blocks of 3)
+    const size_t blockSize = (size + maxBlocks - 1) / maxBlocks;
+    const size_t blocks = (size + blockSize - 1) / blockSize;
+    std::vector<std::optional<T>> totals(blocks);
+    parallel_for(
+        loop,
+        size_t(0),
+        blocks,
+        [&](size_t block) {
+            const size_t begin = block * blockSize;
+            const size_t end = std::min(size, begin + blockSize);
+            T total = first[begin];
+            dFirst[begin] = total;
+            for (size_t i = begin + 1; i < end; ++i) {
+                total = op(std::move(total), first[i]);
+                dFirst[i] = total;
+            }
+            totals[block] = std::move(total);
+        },
+        blockOptions);
+
+    // totals[b] becomes scan of blocks [0, b], it is carry of block b + 1
+    for (size_t block = 2; block < blocks; ++block) {
+        totals[block - 1] = op(*totals[block - 2], *totals[block - 1]);
+    }
+
+    parallel_for(
+        loop,
+        size_t(1),
+        blocks,
+        [&](size_t block) {
+            const T &carry = *totals[block - 1];
+            const size_t begin = block * blockSize;
+            const size_t end = std::min(size, begin + blockSize);
+            for (size_t i = begin; i < end; ++i) {
+                dFirst[i] = op(carry, dFirst[i]);
+            }
+        },
+        blockOptions);
+
+    return dFirst + size;
+}
+
+} // namespace psi::thread
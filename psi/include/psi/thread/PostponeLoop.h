@@ -2,25 +2,34 @@
 
 #include <chrono>
 #include <condition_variable>
-#include <functional>
 #include <map>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 #include "psi/comm/Subscription.h"
+#include "psi/thread/Coroutine.h"
+#include "psi/thread/ILoop.h"
+#include "psi/thread/UniqueFunction.h"
 
 namespace psi::thread {
 
 class PostponeLoop
 {
-    using Func = std::function<void()>;
+    using Func = UniqueFunction<void()>;
     using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
 
 public:
+    class SleepAwaiter;
+
     PostponeLoop();
     virtual ~PostponeLoop();
 
     void invoke(Func &&, const TimePoint &);
+    /// co_await sleepFor(d) resumes coroutine after d on thread of this loop, which should not be blocked long
+    SleepAwaiter sleepFor(std::chrono::nanoseconds);
+    /// co_await sleepFor(d, executor) resumes coroutine after d on executor, no thread is blocked meanwhile
+    SleepAwaiter sleepFor(std::chrono::nanoseconds, ILoop &executor);
     void interrupt();
     bool isRunning();
 
@@ -40,4 +49,18 @@ private:
     psi::comm::Subscription m_crashSub;
 };
 
+/// If loop or executor drops coroutine, co_await throws std::future_error(broken_promise)
+class PostponeLoop::SleepAwaiter final : public detail::ResumeAwaiter
+{
+public:
+    SleepAwaiter(PostponeLoop &, const TimePoint &, ILoop *executor);
+
+    void await_suspend(std::coroutine_handle<>);
+
+private:
+    PostponeLoop &m_loop;
+    TimePoint m_time;
+    ILoop *m_executor;
+};
+
 } // namespace psi::thread
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace psi::thread {
+
+/// FIFO queue over growable circular buffer.
+/// Unlike std::queue (std::deque) it keeps its storage when drained, so steady state push/pop never allocates.
+template <typename T>
+class RingQueue final
+{
+public:
+    RingQueue() = default;
+
+    RingQueue(RingQueue &&other) noexcept
+        : m_data(std::exchange(other.m_data, nullptr))
+        , m_capacity(std::exchange(other.m_capacity, 0u))
+        , m_head(std::exchange(other.m_head, 0u))
+        , m_size(std::exchange(other.m_size, 0u))
+    {
+    }
+
+    RingQueue &operator=(RingQueue &&other) noexcept
+    {
+        if (this != &other) {
+            release();
+            m_data = std::exchange(other.m_data, nullptr);
+            m_capacity = std::exchange(other.m_capacity, 0u);
+            m_head = std::exchange(other.m_head, 0u);
+            m_size = std::exchange(other.m_size, 0u);
+        }
+        return *this;
+    }
+
+    ~RingQueue()
+    {
+        release();
+    }
+
+    template <typename... Args>
+    T &emplace(Args &&...args)
+    {
+        if (m_size == m_capacity) {
+            reserve(m_capacity ? m_capacity * 2 : 16u);
+        }
+
+        T *slot = new (m_data + ((m_head + m_size) & (m_capacity - 1))) T(std::forward<Args>(args)...);
+        ++m_size;
+        return *slot;
+    }
+
+    void push(T &&value)
+    {
+        emplace(std::move(value));
+    }
+
+    T &front()
+    {
+        return m_data[m_head];
+    }
+
+    void pop()
+    {
+        m_data[m_head].~T();
+        m_head = (m_head + 1) & (m_capacity - 1);
+        --m_size;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0u;
+    }
+
+    size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+    void clear()
+    {
+        while (!empty()) {
+            pop();
+        }
+        m_head = 0u;
+    }
+
+    /// Capacity is rounded up to power of two
+    void reserve(size_t capacity)
+    {
+        size_t newCapacity = m_capacity ? m_capacity : 1u;
+        while (newCapacity < capacity) {
+            newCapacity <<= 1;
+        }
+        if (newCapacity <= m_capacity) {
+            return;
+        }
+
+        T *data = std::allocator<T>().allocate(newCapacity);
+        for (size_t i = 0; i < m_size; ++i) {
+            T &item = m_data[(m_head + i) & (m_capacity - 1)];
+            new (data + i) T(std::move(item));
+            item.~T();
+        }
+
+        if (m_data) {
+            std::allocator<T>().deallocate(m_data, m_capacity);
+        }
+        m_data = data;
+        m_capacity = newCapacity;
+        m_head = 0u;
+    }
+
+private:
+    void release()
+    {
+        clear();
+        if (m_data) {
+            std::allocator<T>().deallocate(m_data, m_capacity);
+            m_data = nullptr;
+            m_capacity = 0u;
+        }
+    }
+
+    RingQueue(const RingQueue &) = delete;
+    RingQueue &operator=(const RingQueue &) = delete;
+
+private:
+    T *m_data = nullptr;
+    size_t m_capacity = 0u;
+    size_t m_head = 0u;
+    size_t m_size = 0u;
+};
+
+} // namespace psi::thread
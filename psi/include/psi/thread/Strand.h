@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+
+#include "psi/thread/ILoop.h"
+
+namespace psi::thread {
+
+/// Serialized view over any ILoop (usually ThreadPool): tasks invoked through strand run strictly in invoke order and
+/// never concurrently, but on any free thread of loop, so one busy strand does not hold up others.
+/// Strand is an intrusive MPSC list of tasks plus counter of pending ones: only the invoke which finds it idle gives
+/// a drain task to loop, that task runs queued tasks one by one. It takes a few pointers, so millions of strands are
+/// cheap, every task costs one allocation of list node.
+/// Drain task yields thread back to loop after a few tasks, so a hot strand does not monopolize a worker.
+class Strand final
+{
+public:
+    using Func = ILoop::Func;
+
+    explicit Strand(ILoop &);
+    /// Waits until queued tasks are executed or dropped by loop, must not be called by task of this strand
+    ~Strand();
+
+    /// Thread-safe. If loop drops drain task, queued tasks are destroyed without being called.
+    void invoke(Func &&);
+    /// Queued tasks including the running one. 0 means every invoked task has finished and its effects are visible.
+    size_t size() const;
+
+private:
+    struct NodeBase {
+        std::atomic<NodeBase *> next = nullptr;
+    };
+    struct Node;
+    class DrainTask;
+
+    void schedule();
+    void drain();
+    void discard();
+    /// Takes the oldest task, there must be one (pending counter says so)
+    Func pop();
+    /// True if more tasks are pending
+    bool release();
+
+    Strand(const Strand &) = delete;
+    Strand &operator=(const Strand &) = delete;
+
+private:
+    ILoop &m_loop;
+    /// producers append here
+    std::atomic<NodeBase *> m_tail;
+    /// the last taken node, only drain task touches it
+    NodeBase *m_head;
+    NodeBase m_stub;
+    /// drain task is scheduled or running while it is not 0
+    std::atomic<size_t> m_pending = 0u;
+};
+
+} // namespace psi::thread
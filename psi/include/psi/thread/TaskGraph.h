@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "psi/thread/ILoop.h"
+
+namespace psi::thread {
+
+/// DAG of tasks which is built once and executed many times on any ILoop.
+/// Every node has atomic counter of unfinished predecessors, node which brings counter of successor to zero
+/// releases it, so there is no central scheduler. One released successor is run by the same thread right away,
+/// the others are given to loop.
+/// Once built, execution does not allocate: tasks given to loop fit inline buffer of Func. On ThreadPool with
+/// local queues it holds for up to 256 successors released at once per worker, the first wider fan-out grows
+/// local queue of worker, and later runs reuse that storage.
+class TaskGraph final
+{
+public:
+    using Func = ILoop::Func;
+    using NodeId = size_t;
+
+    TaskGraph() = default;
+    ~TaskGraph();
+
+    /// Graph may not be changed while it is running
+    NodeId addNode(Func &&);
+    /// Node "to" is run after node "from" is finished, throws std::invalid_argument for unknown nodes or self-loop
+    void addEdge(NodeId from, NodeId to);
+    size_t size() const;
+
+    /// Starts root nodes on loop and returns immediately.
+    /// Throws std::invalid_argument if graph has a cycle and std::logic_error if it is still running.
+    void start(ILoop &);
+    /// Blocks until all nodes are finished, rethrows first exception thrown by a node.
+    /// Nodes not started before exception are skipped.
+    void wait();
+    /// start() and wait(). Must not be called from a thread of the loop if loop could be blocked by it.
+    void run(ILoop &);
+    bool isRunning() const;
+
+private:
+    struct Node {
+        Func task;
+        std::vector<NodeId> successors;
+        size_t predecessorsCount = 0u;
+    };
+
+    /// Task given to loop, if loop drops it, execution fails with std::future_error(broken_promise)
+    class NodeTask;
+
+    void prepare();
+    void execute(NodeId);
+    void schedule(NodeId);
+    void fail(std::exception_ptr);
+    void releaseChain();
+    void complete();
+
+    TaskGraph(const TaskGraph &) = delete;
+    TaskGraph &operator=(const TaskGraph &) = delete;
+
+private:
+    std::vector<Node> m_nodes;
+    std::vector<NodeId> m_roots;
+    std::unique_ptr<std::atomic<size_t>[]> m_pendingPredecessors;
+    bool m_isPrepared = false;
+
+    ILoop *m_loop = nullptr;
+    /// chains of nodes run by one thread which are scheduled or running, execution is over when it drops to 0
+    std::atomic<size_t> m_activeChains = 0u;
+    std::atomic<bool> m_hasFailed = false;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_isRunning = false;
+    std::exception_ptr m_error;
+};
+
+} // namespace psi::thread
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#include "psi/thread/ThreadPool.h"
+
+namespace psi::thread {
+
+/// Fork-join group of tasks run on ThreadPool: run() spawns task, wait() joins all of them.
+/// Worker of the pool which waits does not block, it runs queued tasks meanwhile (tasks it spawned itself first),
+/// so groups may be nested inside tasks of the same pool at any depth without exhausting its threads.
+/// Small tasks fit inline buffer of Func, spawning them does not allocate.
+class TaskGroup final
+{
+public:
+    explicit TaskGroup(ThreadPool &);
+    /// Waits for spawned tasks, their exception is lost
+    ~TaskGroup();
+
+    /// Exception thrown by fn is rethrown by wait(). If pool drops the task, wait() throws
+    /// std::future_error(broken_promise).
+    template <typename Fn>
+    void run(Fn &&fn)
+    {
+        m_pending.fetch_add(1u, std::memory_order_relaxed);
+        m_pool.invoke(GroupTask<std::decay_t<Fn>>(this, std::forward<Fn>(fn)));
+    }
+
+    /// Blocks until all spawned tasks are finished, rethrows first exception thrown by them.
+    /// Group may be reused afterwards.
+    void wait();
+
+private:
+    template <typename Fn>
+    class GroupTask final
+    {
+    public:
+        GroupTask(TaskGroup *group, Fn &&fn)
+            : m_group(group)
+            , m_fn(std::move(fn))
+        {
+        }
+
+        GroupTask(TaskGroup *group, const Fn &fn)
+            : m_group(group)
+            , m_fn(fn)
+        {
+        }
+
+        GroupTask(GroupTask &&other) noexcept(std::is_nothrow_move_constructible_v<Fn>)
+            : m_group(std::exchange(other.m_group, nullptr))
+            , m_fn(std::move(other.m_fn))
+        {
+        }
+
+        ~GroupTask()
+        {
+            if (m_group) {
+                m_group->finish(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+            }
+        }
+
+        void operator()()
+        {
+            auto *group = std::exchange(m_group, nullptr);
+            try {
+                m_fn();
+            } catch (...) {
+                group->finish(std::current_exception());
+                return;
+            }
+            group->finish(nullptr);
+        }
+
+    private:
+        GroupTask(const GroupTask &) = delete;
+        GroupTask &operator=(const GroupTask &) = delete;
+        GroupTask &operator=(GroupTask &&) = delete;
+
+    private:
+        TaskGroup *m_group;
+        Fn m_fn;
+    };
+
+    void finish(std::exception_ptr);
+    void join();
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+private:
+    ThreadPool &m_pool;
+    /// spawned tasks which are not finished yet, drops to 0 only under m_mutex
+    std::atomic<size_t> m_pending = 0u;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::exception_ptr m_error;
+};
+
+} // namespace psi::thread
@@ -1,14 +1,26 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <map>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "Coroutine.h"
+#include "DaryHeap.h"
+#include "EventCount.h"
+#include "Future.h"
 #include "ILoop.h"
+#include "IdlePolicy.h"
+#include "MpmcQueue.h"
+#include "OverflowPolicy.h"
+#include "RingQueue.h"
+#include "Topology.h"
 #include "psi/comm/Subscription.h"
 
 namespace psi::thread {
@@ -16,12 +28,152 @@ namespace psi::thread {
 class ThreadPool : public ILoop
 {
 public:
-    ThreadPool(uint8_t numberOfThreads);
+    using Clock = std::chrono::steady_clock;
+    using TenantId = size_t;
+    /// tenant of tasks invoked without one
+    static constexpr TenantId DEFAULT_TENANT = 0u;
+
+    enum class QueueBackend
+    {
+        /// unbounded queue protected by mutex
+        MUTEX = 1,
+        /// bounded lock-free ring buffer, producers and consumers never take pool mutex unless pool is idle
+        LOCK_FREE,
+    };
+
+    /// Lanes are served in strict order with two exceptions:
+    /// NORMAL lane is served once after agingLimit dequeues from CRITICAL lane it waited for (aging),
+    /// BACKGROUND lane is served only when both other lanes are empty.
+    enum class Priority
+    {
+        CRITICAL = 0,
+        NORMAL,
+        BACKGROUND,
+    };
+    static constexpr size_t PRIORITIES_COUNT = 3u;
+
+    struct TenantStats {
+        /// tasks of tenant waiting in queue
+        size_t queued = 0u;
+        /// tasks of tenant taken from queue to be run
+        size_t executed = 0u;
+    };
+
+    struct Options {
+        QueueBackend queueBackend = QueueBackend::MUTEX;
+        /// used by LOCK_FREE backend only, per priority lane, rounded up to power of two.
+        /// Tasks in local queues of workers (see localQueues) take capacity of NORMAL lane.
+        size_t queueCapacity = 65536u;
+        /// used by MUTEX backend only: max number of tasks in all lanes and local queues, 0 means unbounded.
+        /// Workers check the bound of their local queues without lock, so each may exceed it by one task.
+        size_t maxQueueSize = 0u;
+        /// applied when lane of LOCK_FREE backend is full or maxQueueSize of MUTEX backend is reached.
+        /// DROP_OLDEST drops the oldest task of the full lane (LOCK_FREE) or of the least important lane which is not
+        /// more important than the new task (MUTEX), if there is none, the new task is dropped.
+        /// In MUTEX backend the victim belongs to the tenant with the longest queue in that lane and with
+        /// earliestDeadlineFirst it is the least urgent task instead of the oldest one: the latest deadline
+        /// (tasks without deadline go first), the oldest among equal deadlines.
+        /// Workers of the pool are never blocked by it: BLOCK means CALLER_RUNS for them.
+        OverflowPolicy overflowPolicy = OverflowPolicy::BLOCK;
+        /// used by MUTEX backend only: controlled delay (CoDel) load shedding, zero means disabled.
+        /// Every task is timestamped by invoke(). Pool is overloaded while the minimal time tasks spent in queue
+        /// during delayInterval stays above targetDelay, meanwhile sheddable tasks (see invokeSheddable())
+        /// which waited longer than twice targetDelay are shed instead of being run.
+        std::chrono::microseconds targetDelay = std::chrono::microseconds::zero();
+        std::chrono::milliseconds delayInterval = std::chrono::milliseconds(100);
+        /// used by MUTEX backend only: every lane runs the task with the earliest deadline first (EDF),
+        /// tasks without deadline go after all tasks with deadline in FIFO order, so they may starve.
+        /// Otherwise tasks with deadline keep FIFO order, their expiry is checked anyway.
+        bool earliestDeadlineFirst = false;
+        /// used by MUTEX backend only: max number of tasks taken by worker per lock acquisition.
+        /// Real batch is adapted to queue depth (fair share of backlog per worker), 1 means pop-one.
+        size_t maxBatchSize = 1u;
+        IdlePolicy idlePolicy = IdlePolicy::BLOCK;
+        /// number of spin iterations before parking, used by SPIN_THEN_PARK only
+        size_t spinLimit = 2000u;
+        /// max number of dequeues from CRITICAL lane in a row while NORMAL lane is not empty
+        size_t agingLimit = 16u;
+        /// elastic mode if greater than numberOfThreads: pool keeps from numberOfThreads to maxThreads threads,
+        /// the number is tuned by hill climbing on completed tasks per second
+        size_t maxThreads = 0u;
+        /// elastic mode: threads above numberOfThreads which were idle for the whole timeout are retired
+        std::chrono::milliseconds idleTimeout = std::chrono::seconds(10);
+        /// elastic mode: period of throughput measurement and adjustment
+        std::chrono::milliseconds controlInterval = std::chrono::milliseconds(100);
+        /// worker i is pinned to cpuSets[i % cpuSets.size()], empty means no pinning
+        std::vector<CpuSet> cpuSets;
+        /// invoke() called by a worker of this pool puts task to worker's local queue: the latest task goes to
+        /// LIFO slot and runs next on the same thread while its data is hot, older ones may be stolen by idle workers
+        bool localQueues = true;
+    };
+
+    ThreadPool(size_t numberOfThreads = Topology::defaultNumberOfThreads());
+    ThreadPool(size_t numberOfThreads, const Options &);
     virtual ~ThreadPool();
 
+    /// invoke() puts task to NORMAL lane
+    void invoke(Func &&, Priority);
+    /// Never blocks: returns false and leaves task untouched if pool is stopped or queue is full
+    bool tryInvoke(Func &&, Priority = Priority::NORMAL);
+    /// Number of tasks which were not queued because of overflow (see OverflowPolicy)
+    size_t getRejectedTasks() const;
+    /// Task which may be shed under overload (see Options::targetDelay) or dropped by overflow policy,
+    /// in both cases onShed (if any) is called instead of fn. LOCK_FREE backend keeps only fn in queue.
+    void invokeSheddable(Func &&fn, Func &&onShed = {}, Priority = Priority::NORMAL);
+    /// Number of tasks shed by controlled delay
+    size_t getShedTasks() const;
+    /// Task which is not run if its deadline passed before it was dequeued, onExpired (if any) is called instead.
+    /// onExpired is called as well if task is dropped by overflow policy.
+    /// LOCK_FREE backend checks deadline right before the call, wrapped task may not fit inline buffer of Func.
+    /// There onExpired goes with the task, so it is called whenever the task is dropped unrun,
+    /// by interruptImmediately() as well.
+    void invoke(Func &&fn, Clock::time_point deadline, Func &&onExpired = {}, Priority = Priority::NORMAL);
+    /// Number of tasks dropped because of passed deadline
+    size_t getExpiredTasks() const;
+    /// MUTEX backend only: every lane keeps separate queue per tenant, queues are served by deficit round-robin,
+    /// so each tenant gets share of workers proportional to its weight however many tasks others have queued.
+    /// Task goes to NORMAL lane. Weight of unknown tenant is 1, DEFAULT_TENANT is the tenant of plain invoke().
+    void invoke(TenantId, Func &&);
+    /// Throws std::invalid_argument for zero weight
+    void setTenantWeight(TenantId, size_t weight);
+    TenantStats getTenantStats(TenantId) const;
+
+    /// Blocks until queues are empty and no task is executed, returns false on timeout.
+    /// Waiter is woken by the last thread which runs out of work, not by polling.
+    bool waitForIdle(std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max());
+    /// Stops intake like interrupt() and blocks until all queued tasks are executed.
+    /// Returns number of tasks which were queued when intake was stopped.
+    size_t drain();
+    /// Like interruptImmediately(), but tasks which were not executed are moved to unexecutedTasks,
+    /// so they may be given to another loop. Only tasks themselves are given back, their callbacks are dropped.
+    void interruptImmediately(std::vector<Func> &unexecutedTasks);
+
+    /// True if called by a worker of this pool
+    bool isWorkerThread() const;
+    /// Runs one queued task on calling worker, tasks it spawned itself go first.
+    /// Returns false if nothing was queued or if caller is not a worker of this pool.
+    /// Lets worker which waits for other tasks help instead of blocking (see TaskGroup).
+    bool runPendingTask();
+    size_t getWorkload(Priority) const;
+    size_t getNumberOfThreads() const;
+
+    /// Like invoke(), but gives back result or exception of fn
+    template <typename Fn>
+    auto submit(Fn &&fn)
+    {
+        return psi::thread::submit(*this, std::forward<Fn>(fn));
+    }
+
+    /// co_await pool.schedule() continues coroutine on a thread of pool
+    auto schedule()
+    {
+        return psi::thread::schedule(*this);
+    }
+
 public: /// implements ILoop
     void run() override;
     void invoke(Func &&) override;
+    void invokeBatch(std::span<Func>) override;
     void interrupt() override;
     void interruptImmediately() override;
     bool isRunning() override;
@@ -29,18 +181,207 @@ public: /// implements ILoop
     void join() override;
 
 private:
-    void trigger();
-    void onThreadUpdate();
+    struct QueuedTask {
+        Func fn {};
+        /// called instead of fn if task is shed, expired or dropped by overflow policy
+        Func onDropped {};
+        Clock::time_point enqueueTs {};
+        Clock::time_point deadline = Clock::time_point::max();
+        TenantId tenant = DEFAULT_TENANT;
+        bool isSheddable = false;
+    };
+
+    /// FIFO queue of tasks or, in EDF mode, queue ordered by deadline and FIFO among equal deadlines.
+    /// EDF heap holds small keys only, tasks stay in place in reused slots, so sifting does not move them.
+    class TaskQueue
+    {
+    public:
+        void setEarliestDeadlineFirst(bool);
+        void emplace(QueuedTask &&);
+        /// May be moved from before pop()
+        QueuedTask &front();
+        void pop();
+        /// Takes the task to be dropped by DROP_OLDEST: the oldest one or, in EDF mode, the least urgent one
+        /// (the latest deadline, the oldest among equal deadlines)
+        QueuedTask takeVictim();
+        size_t size() const;
+        bool empty() const;
+
+    private:
+        struct DeadlineKey {
+            Clock::time_point deadline;
+            size_t sequence;
+            size_t slot;
+
+            bool operator<(const DeadlineKey &other) const
+            {
+                return deadline < other.deadline || (deadline == other.deadline && sequence < other.sequence);
+            }
+        };
+
+        RingQueue<QueuedTask> m_fifo;
+        DaryHeap<DeadlineKey> m_heap;
+        std::vector<QueuedTask> m_slots;
+        std::vector<size_t> m_freeSlots;
+        size_t m_sequence = 0u;
+        bool m_isEarliestDeadlineFirst = false;
+    };
+
+    /// Queues of tenants served by deficit round-robin. Task costs one unit of deficit, so tenant at the head of
+    /// ring of non-empty queues runs up to its weight of tasks in a row and goes to the tail. Every operation is O(1).
+    class Lane
+    {
+    public:
+        Lane();
+
+        void setEarliestDeadlineFirst(bool);
+        void setTenantWeight(TenantId, size_t weight);
+        TenantStats getTenantStats(TenantId) const;
+        void emplace(QueuedTask &&);
+        /// May be moved from before pop()
+        QueuedTask &front();
+        /// Counts front task as executed by its tenant
+        void countExecuted();
+        void pop();
+        /// Victim of DROP_OLDEST comes from the tenant with the longest queue, the one flooding the lane
+        QueuedTask takeVictim();
+        size_t size() const;
+        bool empty() const;
+
+    private:
+        struct Tenant {
+            TaskQueue queue;
+            size_t weight = 1u;
+            size_t deficit = 0u;
+            size_t executed = 0u;
+        };
+
+        Tenant &tenant(TenantId);
+
+        /// default tenant is the first one, others are added on first use and never removed
+        std::vector<Tenant> m_tenants;
+        std::unordered_map<TenantId, size_t> m_tenantIndexes;
+        RingQueue<size_t> m_activeTenants;
+        size_t m_size = 0u;
+        bool m_isEarliestDeadlineFirst = false;
+    };
+
+    struct Batch {
+        std::vector<Func> tasks;
+        /// shed or expired tasks, notified out of lock
+        std::vector<QueuedTask> droppedTasks;
+        Priority priority = Priority::NORMAL;
+    };
+
+    /// Queue of tasks spawned by one worker. Owner runs LIFO slot first, others steal from the front.
+    /// Queue outlives its worker: retired or crashed worker leaves its tasks to be stolen.
+    struct LocalQueue {
+        std::mutex mutex;
+        Func lifoSlot;
+        RingQueue<Func> tasks;
+        std::atomic<size_t> size = 0;
+        /// guarded by pool's mutex
+        bool isClaimed = false;
+    };
+
+    /// LOCK_FREE backend: task with deadline and its onExpired, lanes keep bare tasks
+    class DeadlineTask;
+
+    void trigger(Batch &);
+    /// Takes tasks from the first lane to be served, false if lanes are empty
+    bool takeBatch(Batch &, size_t maxBatchSize);
+    void triggerLockFree();
+    void requeue(Batch &);
+    size_t selectLane();
+    bool tryPopLockFree(Func &);
+    void updateQueueSize(size_t lane);
+    void onThreadUpdate(size_t);
+    void stopIntake();
+    void takeTasks(std::vector<Func> &);
+    bool isIdle() const;
+    void markBusy();
+    void markIdle();
+    void onControllerUpdate();
+    void spawnThread();
+    void retireThreads(size_t);
+    bool tryRetire();
+    void reapExitedThreads();
+    bool isElastic() const;
+    bool hasPendingTasks() const;
+    bool canResume();
+    void park();
+    void wakeThreads(size_t);
+    bool isBounded() const;
+    bool isFull(size_t lane) const;
+    bool tryPush(QueuedTask &, size_t lane);
+    void overflow(QueuedTask &, size_t lane);
+    void dropOldest(QueuedTask &, size_t lane);
+    void reject(QueuedTask &);
+    bool hasSpace(size_t lane);
+    void waitForSpace(size_t lane);
+    Clock::time_point timestamp() const;
+    bool isOverloaded(Clock::time_point now, Clock::duration delay);
+    void notifyDropped(Batch &);
+    void runTask(Func &);
+    void claimLocalQueue();
+    void releaseLocalQueue();
+    bool hasLocalQueue() const;
+    bool tryPushLocal(Func &);
+    void pushLocal(Func &&);
+    bool tryPopLifo(Func &);
+    bool tryPopLocal(Func &);
+    bool tryPopFrom(LocalQueue &, Func &);
+    void notifySpace();
 
 private:
-    std::mutex m_mutex;
-    std::condition_variable m_condition;
+    mutable std::mutex m_mutex;
+    EventCount m_eventCount;
+    /// producers blocked by full queue
+    EventCount m_spaceEventCount;
     std::vector<std::thread> m_threads;
-    std::queue<Func> m_queue;
-    bool m_isActive;
-    bool m_interruptImmediately;
-    uint8_t m_maxNumberOfThreads;
-    std::atomic<uint8_t> m_aliveThreads = 0;
+    std::array<Lane, PRIORITIES_COUNT> m_lanes;
+    std::array<std::atomic<size_t>, PRIORITIES_COUNT> m_laneSizes {};
+    std::atomic<size_t> m_queueSize = 0;
+    std::array<std::unique_ptr<MpmcQueue<Func>>, PRIORITIES_COUNT> m_lockFreeLanes;
+    std::atomic<size_t> m_bypassedTasks = 0;
+    std::vector<std::unique_ptr<LocalQueue>> m_localQueues;
+    std::atomic<size_t> m_localQueuesSize = 0;
+    std::atomic<bool> m_isActive;
+    /// threads which may hold a task, thread is busy from the moment it looks for a task until it finds none
+    std::atomic<size_t> m_busyThreads = 0;
+    std::atomic<size_t> m_idleWaiters = 0;
+    std::mutex m_idleMutex;
+    std::condition_variable m_idleCondition;
+    std::atomic<bool> m_interruptImmediately;
+    size_t m_maxBatchSize;
+    IdlePolicy m_idlePolicy;
+    size_t m_spinLimit;
+    bool m_isLockFree;
+    size_t m_agingLimit;
+    size_t m_maxQueueSize;
+    OverflowPolicy m_overflowPolicy;
+    std::atomic<size_t> m_rejectedTasks = 0;
+    Clock::duration m_targetDelay;
+    Clock::duration m_delayInterval;
+    /// CoDel state, guarded by m_mutex
+    Clock::time_point m_delayIntervalEndTs;
+    Clock::duration m_minDelay = Clock::duration::max();
+    bool m_isOverloaded = false;
+    std::atomic<size_t> m_shedTasks = 0;
+    std::atomic<size_t> m_expiredTasks = 0;
+    size_t m_numberOfThreads;
+    size_t m_maxNumberOfThreads;
+    std::chrono::milliseconds m_idleTimeout;
+    std::chrono::milliseconds m_controlInterval;
+    std::atomic<size_t> m_aliveThreads = 0;
+    std::atomic<size_t> m_retireRequests = 0;
+    std::atomic<size_t> m_completedTasks = 0;
+    std::vector<std::thread::id> m_exitedThreads;
+    std::vector<CpuSet> m_cpuSets;
+    size_t m_nextWorkerIndex = 0u;
+    std::thread m_controller;
+    std::mutex m_controllerMutex;
+    std::condition_variable m_controllerCondition;
     std::map<std::thread::id, comm::Subscription> m_onCrashSubs;
 };
 
@@ -1,34 +1,80 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <map>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <vector>
 
 #include "psi/comm/Event.h"
 #include "psi/comm/Subscription.h"
+#include "psi/thread/Coroutine.h"
+#include "psi/thread/DispatchPolicy.h"
+#include "psi/thread/EventCount.h"
+#include "psi/thread/Future.h"
 #include "psi/thread/ILoop.h"
+#include "psi/thread/IdlePolicy.h"
+#include "psi/thread/MpscQueue.h"
+#include "psi/thread/OverflowPolicy.h"
+#include "psi/thread/RingQueue.h"
+#include "psi/thread/Topology.h"
 
 namespace psi::thread {
 
 class ThreadPoolQueued : public ILoop
 {
+public:
+    enum class QueueBackend
+    {
+        /// queue protected by mutex, may be bounded
+        MUTEX = 1,
+        /// unbounded lock-free MPSC queue, invoke() never takes a lock
+        LOCK_FREE,
+    };
+
+    struct Options {
+        QueueBackend queueBackend = QueueBackend::MUTEX;
+        /// max number of tasks taken by thread per dequeue (per lock acquisition for MUTEX backend), 1 means pop-one
+        size_t maxBatchSize = 1u;
+        IdlePolicy idlePolicy = IdlePolicy::BLOCK;
+        /// number of spin iterations before parking, used by SPIN_THEN_PARK only
+        size_t spinLimit = 2000u;
+        /// thread i is pinned to cpuSets[i % cpuSets.size()], empty means no pinning
+        std::vector<CpuSet> cpuSets;
+        /// used by MUTEX backend only: max number of tasks in queue of every thread, 0 means unbounded
+        size_t queueCapacity = 0u;
+        /// used by MUTEX backend only: applied when queue of thread is full.
+        /// Threads of the pool are never blocked by it: BLOCK means CALLER_RUNS for them.
+        OverflowPolicy overflowPolicy = OverflowPolicy::BLOCK;
+        /// used by invoke(), tryInvoke() and invokeBatch(), keyed invoke() ignores it
+        DispatchPolicy dispatchPolicy = DispatchPolicy::ROUND_ROBIN;
+    };
+
+private:
     class SimpleThread final
     {
     public:
-        SimpleThread();
+        SimpleThread(ThreadPoolQueued &, const Options &, size_t index);
         ~SimpleThread();
 
         void run();
         void invoke(Func &&);
+        bool tryInvoke(Func &&);
+        void invokeBatch(std::span<Func>);
         void trigger();
         void interrupt();
         void interruptImmediately();
+        void stopIntake();
+        /// Called by thread itself or after it is joined
+        void takeTasks(std::vector<Func> &);
         bool isRunning();
+        bool isIdle();
         size_t getWorkload() const;
+        /// Queued and taken but not finished tasks, max for stopped thread
+        size_t getLoad() const;
+        size_t getRejectedTasks() const;
         void join();
 
         void onThreadUpdate();
@@ -37,15 +83,43 @@ class ThreadPoolQueued : public ILoop
         OnCrashEvent::Interface &onCrashEvent();
 
     private:
+        void park();
+        void markBusy();
+        void markIdle();
+        bool tryPush(Func &);
+        /// Takes tasks to m_batch
+        void takeBatch();
+        void overflow(Func &);
+        void waitForSpace();
+
         SimpleThread(const SimpleThread &) = delete;
         SimpleThread &operator=(const SimpleThread &) = delete;
 
     private:
+        ThreadPoolQueued &m_pool;
         std::mutex m_mutex;
-        std::condition_variable m_condition;
-        std::queue<Func> m_queue;
-        bool m_isActive;
-        bool m_interruptImmediately;
+        EventCount m_eventCount;
+        EventCount m_spaceEventCount;
+        RingQueue<Func> m_queue;
+        MpscQueue<Func> m_lockFreeQueue;
+        const bool m_isLockFree;
+        /// LOCK_FREE backend: incremented before task is linked, so every linked task is counted and counter never
+        /// underflows, consumer which sees it positive may have to retry until the task is linked
+        std::atomic<size_t> m_queueSize = 0;
+        std::vector<Func> m_batch;
+        /// tasks of batch which are not finished yet
+        std::atomic<size_t> m_batchLoad = 0;
+        const size_t m_maxBatchSize;
+        const IdlePolicy m_idlePolicy;
+        const size_t m_spinLimit;
+        const CpuSet m_cpus;
+        const size_t m_queueCapacity;
+        const OverflowPolicy m_overflowPolicy;
+        std::atomic<size_t> m_rejectedTasks = 0;
+        std::atomic<bool> m_isActive;
+        /// thread may hold a task, it is busy from the moment it looks for a task until it finds none
+        std::atomic<bool> m_isBusy = false;
+        std::atomic<bool> m_interruptImmediately;
         std::thread m_thread;
         OnCrashEvent m_onCrashEvent;
 
@@ -53,12 +127,46 @@ class ThreadPoolQueued : public ILoop
     };
 
 public:
-    ThreadPoolQueued(uint8_t numberOfThreads = 10);
+    ThreadPoolQueued(size_t numberOfThreads = Topology::defaultNumberOfThreads());
+    ThreadPoolQueued(size_t numberOfThreads, const Options &);
     virtual ~ThreadPoolQueued();
 
+    /// Never blocks: returns false and leaves task untouched if queue of the next thread is full or pool is stopped
+    bool tryInvoke(Func &&);
+    /// Tasks with the same key (e.g. std::hash of entity id) go to the same thread, so they run in invoke order and
+    /// never concurrently. Keys are spread by jump consistent hash: when a thread crashes, only its keys move to
+    /// other threads. Tasks which were queued on the crashed thread are redirected without their key.
+    void invoke(size_t key, Func &&);
+    /// Number of tasks which were not queued because of overflow (see OverflowPolicy)
+    size_t getRejectedTasks() const;
+
+    /// Blocks until queues are empty and no task is executed, returns false on timeout.
+    /// Waiter is woken by the last thread which runs out of work, not by polling.
+    bool waitForIdle(std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max());
+    /// Stops intake like interrupt() and blocks until all queued tasks are executed.
+    /// Returns number of tasks which were queued when intake was stopped.
+    size_t drain();
+    /// Like interruptImmediately(), but tasks which were not executed are moved to unexecutedTasks,
+    /// so they may be given to another loop.
+    void interruptImmediately(std::vector<Func> &unexecutedTasks);
+
+    /// Like invoke(), but gives back result or exception of fn
+    template <typename Fn>
+    auto submit(Fn &&fn)
+    {
+        return psi::thread::submit(*this, std::forward<Fn>(fn));
+    }
+
+    /// co_await pool.schedule() continues coroutine on a thread of pool
+    auto schedule()
+    {
+        return psi::thread::schedule(*this);
+    }
+
 public: // ILoop implementation
     void run() override;
     void invoke(Func &&) override;
+    void invokeBatch(std::span<Func>) override;
     void interrupt() override;
     void interruptImmediately() override;
     bool isRunning() override;
@@ -66,11 +174,21 @@ public: // ILoop implementation
     void join() override;
 
 private:
-    std::atomic<uint8_t> m_threadIndex = 0;
-    std::atomic<uint8_t> m_aliveThreads = 0;
+    /// Index of thread for the next task according to dispatch policy
+    size_t selectThread();
+    bool isIdle();
+    void notifyIdle();
+
+private:
+    std::atomic<size_t> m_threadIndex = 0;
+    std::atomic<size_t> m_aliveThreads = 0;
     std::vector<std::shared_ptr<SimpleThread>> m_threads;
-    std::map<uint8_t, comm::Subscription> m_onCrashSubs;
-    uint8_t m_maxNumberOfThreads;
+    std::map<size_t, comm::Subscription> m_onCrashSubs;
+    const Options m_options;
+    size_t m_maxNumberOfThreads;
+    std::atomic<size_t> m_idleWaiters = 0;
+    std::mutex m_idleMutex;
+    std::condition_variable m_idleCondition;
 };
 
 } // namespace psi::thread
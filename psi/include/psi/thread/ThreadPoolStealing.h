@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "psi/comm/Subscription.h"
+#include "psi/thread/ILoop.h"
+#include "psi/thread/RingQueue.h"
+#include "psi/thread/WorkStealingDeque.h"
+
+namespace psi::thread {
+
+/// Work-stealing pool.
+/// Every worker owns a deque for tasks spawned by itself and an inbox for tasks submitted from outside.
+/// Workers run their own tasks first (LIFO), then their inbox (FIFO), and steal from random victims when idle.
+class ThreadPoolStealing : public ILoop
+{
+    struct Worker final {
+        WorkStealingDeque<Func *> deque;
+        std::mutex inboxMutex;
+        RingQueue<Func> inbox;
+        std::minstd_rand random;
+    };
+
+public:
+    ThreadPoolStealing(size_t numberOfThreads);
+    virtual ~ThreadPoolStealing();
+
+public: /// implements ILoop
+    void run() override;
+    void invoke(Func &&) override;
+    void invokeBatch(std::span<Func>) override;
+    void interrupt() override;
+    void interruptImmediately() override;
+    bool isRunning() override;
+    size_t getWorkload() const override;
+    void join() override;
+
+private:
+    void trigger(size_t);
+    void onThreadUpdate(size_t);
+    bool popTask(size_t, Func &);
+    bool stealTask(size_t, Func &);
+    void notifySleeper();
+    void notifySleepers(size_t);
+    void clearQueues();
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::vector<std::thread> m_threads;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<size_t> m_pendingTasks = 0;
+    std::atomic<size_t> m_sleepingThreads = 0;
+    std::atomic<size_t> m_nextInbox = 0;
+    std::atomic<bool> m_isActive;
+    std::atomic<bool> m_interruptImmediately;
+    size_t m_maxNumberOfThreads;
+    std::atomic<size_t> m_aliveThreads = 0;
+    std::map<std::thread::id, comm::Subscription> m_onCrashSubs;
+};
+
+} // namespace psi::thread
@@ -2,7 +2,6 @@
 
 #include <chrono>
 #include <condition_variable>
-#include <functional>
 #include <map>
 #include <mutex>
 #include <thread>
@@ -10,12 +9,13 @@
 
 #include "psi/comm/Subscription.h"
 #include "psi/thread/Timer.h"
+#include "psi/thread/UniqueFunction.h"
 
 namespace psi::thread {
 
 class TimerLoop
 {
-    using Func = std::function<void()>;
+    using Func = UniqueFunction<void()>;
     using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
 
 public:
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace psi::thread {
+
+/// List of logical CPU ids
+using CpuSet = std::vector<size_t>;
+
+struct NumaNode {
+    size_t id = 0u;
+    CpuSet cpus;
+};
+
+/// Machine topology as seen by current process.
+/// On Linux it is read from sched_getaffinity, /sys and cgroup, elsewhere falls back to single node
+/// of std::thread::hardware_concurrency() CPUs.
+class Topology final
+{
+public:
+    /// CPUs current process is allowed to run on
+    static CpuSet availableCpus();
+
+    /// NUMA nodes restricted to available CPUs, nodes without available CPUs are skipped
+    static std::vector<NumaNode> numaNodes();
+
+    /// Number of available CPUs, limited by cgroup CPU quota if any, at least 1
+    static size_t defaultNumberOfThreads();
+
+    /// Pins calling thread to given CPUs, returns false if not supported or failed
+    static bool pinCurrentThread(const CpuSet &);
+
+    /// Index in numaNodes() of node which calling thread runs on, if known
+    static std::optional<size_t> currentNode(const std::vector<NumaNode> &);
+
+    /// Parses kernel cpu list format: "0-3,8,10-11"
+    static CpuSet parseCpuList(const std::string &);
+
+    /// Parses cgroup v2 cpu.max content: "max 100000" or "<quota> <period>", returns number of CPUs rounded up,
+    /// 0 if there is no limit
+    static size_t parseCpuMax(const std::string &);
+};
+
+} // namespace psi::thread
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifndef PSI_THREAD_FUNC_BUFFER_SIZE
+#define PSI_THREAD_FUNC_BUFFER_SIZE 64
+#endif
+
+namespace psi::thread {
+
+template <typename Signature, size_t BufferSize = PSI_THREAD_FUNC_BUFFER_SIZE>
+class UniqueFunction;
+
+/// Move-only replacement of std::function.
+/// Callables up to BufferSize bytes (nothrow movable, default alignment) are stored inline without heap allocation,
+/// bigger ones are allocated once on construction and only the pointer is moved afterwards.
+/// Move-only callables (lambdas owning unique_ptr, promise etc.) are supported.
+template <typename R, typename... Args, size_t BufferSize>
+class UniqueFunction<R(Args...), BufferSize> final
+{
+    static_assert(BufferSize >= sizeof(void *), "buffer should be able to hold at least a pointer");
+
+    struct Operations {
+        R (*invoke)(void *, Args &&...);
+        void (*move)(void * /*to*/, void * /*from*/) noexcept;
+        void (*destroy)(void *) noexcept;
+    };
+
+    template <typename F>
+    struct IsNullable : std::bool_constant<std::is_pointer_v<F> || std::is_member_pointer_v<F>> {
+    };
+
+    template <typename S>
+    struct IsNullable<std::function<S>> : std::true_type {
+    };
+
+    template <typename F>
+    static constexpr bool isInline = sizeof(F) <= BufferSize && alignof(F) <= alignof(std::max_align_t)
+                                     && std::is_nothrow_move_constructible_v<F>;
+
+    template <typename F>
+    struct InlineOperations {
+        static F *get(void *storage)
+        {
+            return std::launder(reinterpret_cast<F *>(storage));
+        }
+
+        static R invoke(void *storage, Args &&...args)
+        {
+            return std::invoke(*get(storage), std::forward<Args>(args)...);
+        }
+
+        static void move(void *to, void *from) noexcept
+        {
+            new (to) F(std::move(*get(from)));
+            get(from)->~F();
+        }
+
+        static void destroy(void *storage) noexcept
+        {
+            get(storage)->~F();
+        }
+
+        static constexpr Operations operations = {&invoke, &move, &destroy};
+    };
+
+    template <typename F>
+    struct HeapOperations {
+        static F *&get(void *storage)
+        {
+            return *std::launder(reinterpret_cast<F **>(storage));
+        }
+
+        static R invoke(void *storage, Args &&...args)
+        {
+            return std::invoke(*get(storage), std::forward<Args>(args)...);
+        }
+
+        static void move(void *to, void *from) noexcept
+        {
+            new (to) F *(get(from));
+        }
+
+        static void destroy(void *storage) noexcept
+        {
+            delete get(storage);
+        }
+
+        static constexpr Operations operations = {&invoke, &move, &destroy};
+    };
+
+public:
+    UniqueFunction() noexcept = default;
+
+    UniqueFunction(std::nullptr_t) noexcept {}
+
+    template <typename F,
+              typename Fn = std::decay_t<F>,
+              typename =
+                  std::enable_if_t<!std::is_same_v<Fn, UniqueFunction> && std::is_invocable_r_v<R, Fn &, Args...>>>
+    UniqueFunction(F &&fn)
+    {
+        if constexpr (IsNullable<Fn>::value) {
+            if (!fn) {
+                return;
+            }
+        }
+
+        if constexpr (isInline<Fn>) {
+            new (m_storage) Fn(std::forward<F>(fn));
+            m_operations = &InlineOperations<Fn>::operations;
+        } else {
+            new (m_storage) Fn *(new Fn(std::forward<F>(fn)));
+            m_operations = &HeapOperations<Fn>::operations;
+        }
+    }
+
+    UniqueFunction(UniqueFunction &&other) noexcept
+    {
+        moveFrom(other);
+    }
+
+    UniqueFunction &operator=(UniqueFunction &&other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    UniqueFunction &operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    ~UniqueFunction()
+    {
+        reset();
+    }
+
+    R operator()(Args... args)
+    {
+        if (!m_operations) {
+            throw std::bad_function_call();
+        }
+        return m_operations->invoke(m_storage, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return m_operations != nullptr;
+    }
+
+    friend bool operator==(const UniqueFunction &fn, std::nullptr_t) noexcept
+    {
+        return !fn;
+    }
+
+private:
+    void moveFrom(UniqueFunction &other) noexcept
+    {
+        if (other.m_operations) {
+            other.m_operations->move(m_storage, other.m_storage);
+            m_operations = other.m_operations;
+            other.m_operations = nullptr;
+        }
+    }
+
+    void reset() noexcept
+    {
+        if (m_operations) {
+            m_operations->destroy(m_storage);
+            m_operations = nullptr;
+        }
+    }
+
+    UniqueFunction(const UniqueFunction &) = delete;
+    UniqueFunction &operator=(const UniqueFunction &) = delete;
+
+private:
+    const Operations *m_operations = nullptr;
+    alignas(std::max_align_t) unsigned char m_storage[BufferSize];
+};
+
+} // namespace psi::thread
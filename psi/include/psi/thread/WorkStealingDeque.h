@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace psi::thread {
+
+/// Chase-Lev work-stealing deque.
+/// Owner thread calls push() and pop() at the bottom, any other thread may call steal() at the top.
+/// Elements are copied by value into atomic slots, so T must be trivially copyable (usually a pointer).
+template <typename T>
+class WorkStealingDeque final
+{
+    static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque requires trivially copyable elements");
+
+    class Buffer
+    {
+    public:
+        explicit Buffer(int64_t capacity)
+            : m_capacity(capacity)
+            , m_mask(capacity - 1)
+            , m_slots(new std::atomic<T>[capacity])
+        {
+        }
+
+        int64_t capacity() const
+        {
+            return m_capacity;
+        }
+
+        T get(int64_t index) const
+        {
+            return m_slots[index & m_mask].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t index, T value)
+        {
+            m_slots[index & m_mask].store(value, std::memory_order_relaxed);
+        }
+
+        Buffer *grow(int64_t bottom, int64_t top) const
+        {
+            auto result = new Buffer(m_capacity * 2);
+            for (int64_t i = top; i != bottom; ++i) {
+                result->put(i, get(i));
+            }
+            return result;
+        }
+
+    private:
+        const int64_t m_capacity;
+        const int64_t m_mask;
+        std::unique_ptr<std::atomic<T>[]> m_slots;
+    };
+
+public:
+    explicit WorkStealingDeque(int64_t initialCapacity = 256)
+        : m_top(0)
+        , m_bottom(0)
+        , m_buffer(new Buffer(initialCapacity))
+    {
+        m_retired.emplace_back(m_buffer.load(std::memory_order_relaxed));
+    }
+
+    /// Owner only
+    void push(T value)
+    {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_top.load(std::memory_order_acquire);
+        Buffer *buffer = m_buffer.load(std::memory_order_relaxed);
+
+        if (bottom - top > buffer->capacity() - 1) {
+            // old buffers are kept alive until destruction since stealers may still read them
+            buffer = buffer->grow(bottom, top);
+            m_retired.emplace_back(buffer);
+            m_buffer.store(buffer, std::memory_order_release);
+        }
+
+        buffer->put(bottom, value);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    /// Owner only, LIFO end
+    std::optional<T> pop()
+    {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        Buffer *buffer = m_buffer.load(std::memory_order_relaxed);
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+
+        T value = buffer->get(bottom);
+        if (top == bottom) {
+            // last element, race against stealers
+            const bool won =
+                m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            if (!won) {
+                return std::nullopt;
+            }
+        }
+
+        return value;
+    }
+
+    /// Any thread, FIFO end
+    std::optional<T> steal()
+    {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+        if (top >= bottom) {
+            return std::nullopt;
+        }
+
+        Buffer *buffer = m_buffer.load(std::memory_order_acquire);
+        T value = buffer->get(top);
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return std::nullopt;
+        }
+
+        return value;
+    }
+
+    /// Approximate when called concurrently
+    size_t size() const
+    {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_top.load(std::memory_order_relaxed);
+        return bottom > top ? static_cast<size_t>(bottom - top) : 0u;
+    }
+
+    bool empty() const
+    {
+        return size() == 0u;
+    }
+
+private:
+    WorkStealingDeque(const WorkStealingDeque &) = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+private:
+    alignas(64) std::atomic<int64_t> m_top;
+    alignas(64) std::atomic<int64_t> m_bottom;
+    std::atomic<Buffer *> m_buffer;
+    std::vector<std::unique_ptr<Buffer>> m_retired;
+};
+
+} // namespace psi::thread
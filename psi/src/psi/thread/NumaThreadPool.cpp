@@ -0,0 +1,129 @@
+#include "psi/thread/NumaThreadPool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace psi::thread {
+
+NumaThreadPool::NumaThreadPool()
+    : NumaThreadPool(Options())
+{
+}
+
+NumaThreadPool::NumaThreadPool(const Options &options)
+    : NumaThreadPool(Topology::numaNodes(), options)
+{
+}
+
+NumaThreadPool::NumaThreadPool(std::vector<NumaNode> nodes, const Options &options)
+    : m_nodes(std::move(nodes))
+{
+    if (m_nodes.empty()) {
+        throw std::invalid_argument("NumaThreadPool: no NUMA nodes");
+    }
+
+    // cgroup quota is shared by all nodes
+    const size_t quotaPerNode = (Topology::defaultNumberOfThreads() + m_nodes.size() - 1) / m_nodes.size();
+
+    for (const auto &node : m_nodes) {
+        auto poolOptions = options.poolOptions;
+        poolOptions.cpuSets = {node.cpus};
+
+        size_t numberOfThreads = options.threadsPerNode;
+        if (!numberOfThreads) {
+            numberOfThreads = std::max<size_t>(std::min(node.cpus.size(), quotaPerNode), 1u);
+        }
+        if (poolOptions.maxThreads) {
+            poolOptions.maxThreads = std::max(poolOptions.maxThreads, numberOfThreads);
+        }
+
+        m_shards.emplace_back(std::make_unique<ThreadPool>(numberOfThreads, poolOptions));
+    }
+}
+
+NumaThreadPool::~NumaThreadPool()
+{
+    interrupt();
+}
+
+void NumaThreadPool::run()
+{
+    for (auto &shard : m_shards) {
+        shard->run();
+    }
+}
+
+void NumaThreadPool::invoke(Func &&fn)
+{
+    m_shards[selectShard()]->invoke(std::forward<Func>(fn));
+}
+
+void NumaThreadPool::invoke(Func &&fn, size_t node)
+{
+    m_shards[node % m_shards.size()]->invoke(std::forward<Func>(fn));
+}
+
+void NumaThreadPool::invokeBatch(std::span<Func> tasks)
+{
+    m_shards[selectShard()]->invokeBatch(tasks);
+}
+
+void NumaThreadPool::interrupt()
+{
+    for (auto &shard : m_shards) {
+        shard->interrupt();
+    }
+}
+
+void NumaThreadPool::interruptImmediately()
+{
+    for (auto &shard : m_shards) {
+        shard->interruptImmediately();
+    }
+}
+
+bool NumaThreadPool::isRunning()
+{
+    return std::any_of(m_shards.begin(), m_shards.end(), [](const auto &shard) { return shard->isRunning(); });
+}
+
+size_t NumaThreadPool::getWorkload() const
+{
+    size_t result = 0u;
+    for (const auto &shard : m_shards) {
+        result += shard->getWorkload();
+    }
+    return result;
+}
+
+size_t NumaThreadPool::getWorkload(size_t node) const
+{
+    return m_shards[node % m_shards.size()]->getWorkload();
+}
+
+const std::vector<NumaNode> &NumaThreadPool::getNodes() const
+{
+    return m_nodes;
+}
+
+void NumaThreadPool::join()
+{
+    for (auto &shard : m_shards) {
+        shard->join();
+    }
+}
+
+size_t NumaThreadPool::selectShard()
+{
+    if (m_shards.size() == 1u) {
+        return 0u;
+    }
+
+    if (const auto node = Topology::currentNode(m_nodes)) {
+        return *node;
+    }
+
+    return m_nextShard++ % m_shards.size();
+}
+
+} // namespace psi::thread
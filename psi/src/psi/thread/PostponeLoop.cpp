@@ -79,7 +79,37 @@ void PostponeLoop::invoke(Func &&fn, const TimePoint &tp)
         m_condition.notify_one();
     }
 
-    m_queue[tp].emplace_back(fn);
+    m_queue[tp].emplace_back(std::forward<Func>(fn));
+}
+
+PostponeLoop::SleepAwaiter PostponeLoop::sleepFor(std::chrono::nanoseconds duration)
+{
+    return SleepAwaiter(*this, std::chrono::high_resolution_clock::now() + duration, nullptr);
+}
+
+PostponeLoop::SleepAwaiter PostponeLoop::sleepFor(std::chrono::nanoseconds duration, ILoop &executor)
+{
+    return SleepAwaiter(*this, std::chrono::high_resolution_clock::now() + duration, &executor);
+}
+
+PostponeLoop::SleepAwaiter::SleepAwaiter(PostponeLoop &loop, const TimePoint &time, ILoop *executor)
+    : m_loop(loop)
+    , m_time(time)
+    , m_executor(executor)
+{
+}
+
+void PostponeLoop::SleepAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    if (!m_executor) {
+        m_loop.invoke(makeResumer(handle), m_time);
+        return;
+    }
+
+    // timer thread only hands coroutine over to executor
+    m_loop.invoke([executor = m_executor, resumer = makeResumer(handle)]() mutable {
+        executor->invoke(std::move(resumer));
+    }, m_time);
 }
 
 void PostponeLoop::trigger()
@@ -105,7 +135,7 @@ void PostponeLoop::trigger()
     }
 
     auto itr = m_queue.begin();
-    auto calls = itr->second;
+    auto calls = std::move(itr->second);
     m_queue.erase(itr);
     if (!m_queue.empty()) {
         itr = m_queue.begin();
@@ -114,7 +144,7 @@ void PostponeLoop::trigger()
 
     lock.unlock();
 
-    for (auto fn : calls) {
+    for (auto &fn : calls) {
         fn();
     }
 }
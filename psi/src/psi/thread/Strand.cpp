@@ -0,0 +1,146 @@
+#include "psi/thread/Strand.h"
+
+#include <thread>
+#include <utility>
+
+namespace psi::thread {
+
+namespace {
+/// tasks run by one drain task before it gives thread back to loop
+constexpr size_t MAX_TASKS_PER_DRAIN = 32u;
+} // namespace
+
+struct Strand::Node final : NodeBase {
+    explicit Node(Func &&task)
+        : fn(std::move(task))
+    {
+    }
+
+    Func fn;
+};
+
+class Strand::DrainTask final
+{
+public:
+    explicit DrainTask(Strand *strand)
+        : m_strand(strand)
+    {
+    }
+
+    DrainTask(DrainTask &&other) noexcept
+        : m_strand(std::exchange(other.m_strand, nullptr))
+    {
+    }
+
+    ~DrainTask()
+    {
+        if (m_strand) {
+            m_strand->discard();
+        }
+    }
+
+    void operator()()
+    {
+        std::exchange(m_strand, nullptr)->drain();
+    }
+
+private:
+    DrainTask(const DrainTask &) = delete;
+    DrainTask &operator=(const DrainTask &) = delete;
+    DrainTask &operator=(DrainTask &&) = delete;
+
+private:
+    Strand *m_strand;
+};
+
+Strand::Strand(ILoop &loop)
+    : m_loop(loop)
+    , m_tail(&m_stub)
+    , m_head(&m_stub)
+{
+}
+
+Strand::~Strand()
+{
+    // the last drain task does not touch strand after counter drops to 0
+    while (m_pending.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    if (m_head != &m_stub) {
+        delete static_cast<Node *>(m_head);
+    }
+}
+
+void Strand::invoke(Func &&fn)
+{
+    NodeBase *node = new Node(std::move(fn));
+    m_tail.exchange(node, std::memory_order_acq_rel)->next.store(node, std::memory_order_release);
+    if (!m_pending.fetch_add(1u, std::memory_order_acq_rel)) {
+        schedule();
+    }
+}
+
+size_t Strand::size() const
+{
+    // pairs with release(), so effects of finished tasks are visible to caller
+    return m_pending.load(std::memory_order_acquire);
+}
+
+void Strand::schedule()
+{
+    m_loop.invoke(DrainTask(this));
+}
+
+void Strand::drain()
+{
+    for (size_t executed = 1u;; ++executed) {
+        auto fn = pop();
+        try {
+            fn();
+        } catch (...) {
+            // the rest of strand is not lost with the thread
+            if (release()) {
+                schedule();
+            }
+            throw;
+        }
+
+        if (!release()) {
+            return;
+        }
+        if (executed == MAX_TASKS_PER_DRAIN) {
+            schedule();
+            return;
+        }
+    }
+}
+
+void Strand::discard()
+{
+    do {
+        pop();
+    } while (release());
+}
+
+Strand::Func Strand::pop()
+{
+    // counter is incremented after node is linked, but other producer may still be linking preceding node
+    NodeBase *next = m_head->next.load(std::memory_order_acquire);
+    while (!next) {
+        std::this_thread::yield();
+        next = m_head->next.load(std::memory_order_acquire);
+    }
+
+    if (m_head != &m_stub) {
+        delete static_cast<Node *>(m_head);
+    }
+    m_head = next;
+    return std::move(static_cast<Node *>(next)->fn);
+}
+
+bool Strand::release()
+{
+    return m_pending.fetch_sub(1u, std::memory_order_acq_rel) != 1u;
+}
+
+} // namespace psi::thread
@@ -0,0 +1,238 @@
+#include "psi/thread/TaskGraph.h"
+
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace psi::thread {
+
+namespace {
+constexpr TaskGraph::NodeId NO_NODE = std::numeric_limits<TaskGraph::NodeId>::max();
+}
+
+class TaskGraph::NodeTask final
+{
+public:
+    NodeTask(TaskGraph *graph, NodeId node)
+        : m_graph(graph)
+        , m_node(node)
+    {
+    }
+
+    NodeTask(NodeTask &&other) noexcept
+        : m_graph(std::exchange(other.m_graph, nullptr))
+        , m_node(other.m_node)
+    {
+    }
+
+    ~NodeTask()
+    {
+        if (m_graph) {
+            m_graph->fail(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+            m_graph->releaseChain();
+        }
+    }
+
+    void operator()()
+    {
+        std::exchange(m_graph, nullptr)->execute(m_node);
+    }
+
+private:
+    NodeTask(const NodeTask &) = delete;
+    NodeTask &operator=(const NodeTask &) = delete;
+    NodeTask &operator=(NodeTask &&) = delete;
+
+private:
+    TaskGraph *m_graph;
+    NodeId m_node;
+};
+
+TaskGraph::~TaskGraph()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this]() { return !m_isRunning; });
+}
+
+TaskGraph::NodeId TaskGraph::addNode(Func &&task)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_isRunning) {
+        throw std::logic_error("TaskGraph: can not be changed while running");
+    }
+
+    m_nodes.emplace_back(Node {std::move(task), {}, 0u});
+    m_isPrepared = false;
+    return m_nodes.size() - 1u;
+}
+
+void TaskGraph::addEdge(NodeId from, NodeId to)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_isRunning) {
+        throw std::logic_error("TaskGraph: can not be changed while running");
+    }
+    if (from >= m_nodes.size() || to >= m_nodes.size() || from == to) {
+        throw std::invalid_argument("TaskGraph: invalid edge");
+    }
+
+    m_nodes[from].successors.emplace_back(to);
+    ++m_nodes[to].predecessorsCount;
+    m_isPrepared = false;
+}
+
+size_t TaskGraph::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_nodes.size();
+}
+
+void TaskGraph::start(ILoop &loop)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_isRunning) {
+            throw std::logic_error("TaskGraph: is already running");
+        }
+
+        prepare();
+
+        for (size_t i = 0; i < m_nodes.size(); ++i) {
+            m_pendingPredecessors[i].store(m_nodes[i].predecessorsCount, std::memory_order_relaxed);
+        }
+        m_loop = &loop;
+        m_error = nullptr;
+        m_hasFailed.store(false, std::memory_order_relaxed);
+        m_activeChains.store(m_roots.size(), std::memory_order_relaxed);
+        m_isRunning = !m_roots.empty();
+    }
+
+    // graph may be finished and destroyed as soon as the last root is given to loop
+    const size_t rootsCount = m_roots.size();
+    for (size_t i = 0; i < rootsCount; ++i) {
+        loop.invoke(NodeTask(this, m_roots[i]));
+    }
+}
+
+void TaskGraph::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this]() { return !m_isRunning; });
+    if (auto error = std::exchange(m_error, nullptr)) {
+        std::rethrow_exception(error);
+    }
+}
+
+void TaskGraph::run(ILoop &loop)
+{
+    start(loop);
+    wait();
+}
+
+bool TaskGraph::isRunning() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_isRunning;
+}
+
+void TaskGraph::prepare()
+{
+    if (m_isPrepared) {
+        return;
+    }
+
+    // Kahn's algorithm: every node must be reachable from roots once its predecessors are done
+    std::vector<size_t> pending(m_nodes.size());
+    std::vector<NodeId> order;
+    order.reserve(m_nodes.size());
+    for (NodeId i = 0; i < m_nodes.size(); ++i) {
+        pending[i] = m_nodes[i].predecessorsCount;
+        if (!pending[i]) {
+            order.emplace_back(i);
+        }
+    }
+    const size_t rootsCount = order.size();
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        for (NodeId successor : m_nodes[order[i]].successors) {
+            if (!--pending[successor]) {
+                order.emplace_back(successor);
+            }
+        }
+    }
+
+    if (order.size() != m_nodes.size()) {
+        throw std::invalid_argument("TaskGraph: graph has a cycle");
+    }
+
+    m_roots.assign(order.begin(), order.begin() + rootsCount);
+    m_pendingPredecessors = std::make_unique<std::atomic<size_t>[]>(m_nodes.size());
+    m_isPrepared = true;
+}
+
+void TaskGraph::execute(NodeId id)
+{
+    while (!m_hasFailed.load(std::memory_order_relaxed)) {
+        Node &node = m_nodes[id];
+        try {
+            node.task();
+        } catch (...) {
+            fail(std::current_exception());
+            break;
+        }
+
+        // first released successor continues on this thread while its inputs are still in cache
+        NodeId next = NO_NODE;
+        for (NodeId successor : node.successors) {
+            if (m_pendingPredecessors[successor].fetch_sub(1u, std::memory_order_acq_rel) != 1u) {
+                continue;
+            }
+            if (next == NO_NODE) {
+                next = successor;
+            } else {
+                schedule(successor);
+            }
+        }
+
+        if (next == NO_NODE) {
+            break;
+        }
+        id = next;
+    }
+
+    releaseChain();
+}
+
+void TaskGraph::schedule(NodeId id)
+{
+    // calling chain is still active, so counter can not drop to 0 meanwhile
+    m_activeChains.fetch_add(1u, std::memory_order_relaxed);
+    m_loop->invoke(NodeTask(this, id));
+}
+
+void TaskGraph::fail(std::exception_ptr error)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_error) {
+        m_error = std::move(error);
+    }
+    m_hasFailed.store(true, std::memory_order_relaxed);
+}
+
+void TaskGraph::releaseChain()
+{
+    if (m_activeChains.fetch_sub(1u, std::memory_order_acq_rel) == 1u) {
+        complete();
+    }
+}
+
+void TaskGraph::complete()
+{
+    // notified under lock: waiter may destroy graph right after it sees the flag
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isRunning = false;
+    m_condition.notify_all();
+}
+
+} // namespace psi::thread
@@ -0,0 +1,65 @@
+#include "psi/thread/TaskGroup.h"
+
+#include <thread>
+
+namespace psi::thread {
+
+TaskGroup::TaskGroup(ThreadPool &pool)
+    : m_pool(pool)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    join();
+}
+
+void TaskGroup::wait()
+{
+    join();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (auto error = std::exchange(m_error, nullptr)) {
+        std::rethrow_exception(error);
+    }
+}
+
+void TaskGroup::finish(std::exception_ptr error)
+{
+    if (error) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_error) {
+            m_error = std::move(error);
+        }
+    }
+
+    // only the last task takes the lock
+    size_t pending = m_pending.load(std::memory_order_relaxed);
+    while (pending > 1u) {
+        if (m_pending.compare_exchange_weak(pending, pending - 1u, std::memory_order_acq_rel)) {
+            return;
+        }
+    }
+
+    // notified under lock: waiter may destroy group right after it sees 0
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pending.fetch_sub(1u, std::memory_order_acq_rel) == 1u) {
+        m_condition.notify_all();
+    }
+}
+
+void TaskGroup::join()
+{
+    // blocked worker may hold the very threads its tasks are queued for, so it runs queued tasks instead
+    if (m_pool.isWorkerThread()) {
+        while (m_pending.load(std::memory_order_acquire)) {
+            if (!m_pool.runPendingTask()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this]() { return !m_pending.load(std::memory_order_acquire); });
+}
+
+} // namespace psi::thread
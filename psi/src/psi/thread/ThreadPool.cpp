@@ -2,6 +2,11 @@
 
 #include "psi/thread/CrashHandler.h"
 
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
 #ifdef PSI_LOGGER
 #include "psi/logger/Logger.h"
 #else
@@ -18,11 +23,119 @@
 
 namespace psi::thread {
 
-ThreadPool::ThreadPool(uint8_t numberOfThreads)
+namespace {
+constexpr size_t CRITICAL_LANE = static_cast<size_t>(ThreadPool::Priority::CRITICAL);
+constexpr size_t NORMAL_LANE = static_cast<size_t>(ThreadPool::Priority::NORMAL);
+constexpr size_t BACKGROUND_LANE = static_cast<size_t>(ThreadPool::Priority::BACKGROUND);
+
+/// tasks run from LIFO slot in a row before other queues get a turn, so ping-ponging tasks can not starve them
+constexpr size_t MAX_LIFO_STREAK = 16u;
+constexpr size_t NO_LOCAL_QUEUE = std::numeric_limits<size_t>::max();
+/// storage reserved for local queue by the first worker which claims it: fan-out of a task (e.g. TaskGraph node)
+/// up to this size is spawned without allocation, queue keeps storage it has grown to once drained
+constexpr size_t LOCAL_QUEUE_RESERVE = 256u;
+
+/// pool of the current worker thread
+thread_local const ThreadPool *t_pool = nullptr;
+thread_local size_t t_localQueue = NO_LOCAL_QUEUE;
+thread_local size_t t_lifoStreak = 0u;
+thread_local bool t_isBusy = false;
+} // namespace
+
+class ThreadPool::DeadlineTask final
+{
+public:
+    DeadlineTask(ThreadPool *pool, Func &&fn, Clock::time_point deadline, Func &&onExpired)
+        : m_pool(pool)
+        , m_fn(std::move(fn))
+        , m_onExpired(std::move(onExpired))
+        , m_deadline(deadline)
+    {
+    }
+
+    DeadlineTask(DeadlineTask &&other) noexcept
+        : m_pool(std::exchange(other.m_pool, nullptr))
+        , m_fn(std::move(other.m_fn))
+        , m_onExpired(std::move(other.m_onExpired))
+        , m_deadline(other.m_deadline)
+    {
+    }
+
+    /// task is dropped without being run, e.g. by overflow policy
+    ~DeadlineTask()
+    {
+        if (m_pool && m_onExpired) {
+            m_onExpired();
+        }
+    }
+
+    void operator()()
+    {
+        auto *pool = std::exchange(m_pool, nullptr);
+        if (Clock::now() <= m_deadline) {
+            m_fn();
+            return;
+        }
+        pool->m_expiredTasks.fetch_add(1u, std::memory_order_relaxed);
+        if (m_onExpired) {
+            m_onExpired();
+        }
+    }
+
+private:
+    DeadlineTask(const DeadlineTask &) = delete;
+    DeadlineTask &operator=(const DeadlineTask &) = delete;
+    DeadlineTask &operator=(DeadlineTask &&) = delete;
+
+private:
+    ThreadPool *m_pool;
+    Func m_fn;
+    Func m_onExpired;
+    Clock::time_point m_deadline;
+};
+
+ThreadPool::ThreadPool(size_t numberOfThreads)
+    : ThreadPool(numberOfThreads, Options())
+{
+}
+
+ThreadPool::ThreadPool(size_t numberOfThreads, const Options &options)
     : m_isActive(false)
     , m_interruptImmediately(false)
-    , m_maxNumberOfThreads(numberOfThreads)
+    , m_maxBatchSize(std::max<size_t>(options.maxBatchSize, 1u))
+    , m_idlePolicy(options.idlePolicy)
+    , m_spinLimit(options.spinLimit)
+    , m_isLockFree(options.queueBackend == QueueBackend::LOCK_FREE)
+    , m_agingLimit(options.agingLimit)
+    , m_maxQueueSize(options.maxQueueSize)
+    , m_overflowPolicy(options.overflowPolicy)
+    , m_targetDelay(options.targetDelay)
+    , m_delayInterval(options.delayInterval)
+    , m_numberOfThreads(numberOfThreads)
+    , m_maxNumberOfThreads(std::max(numberOfThreads, options.maxThreads))
+    , m_idleTimeout(options.idleTimeout)
+    , m_controlInterval(options.controlInterval)
+    , m_cpuSets(options.cpuSets)
 {
+    if (options.maxThreads && options.maxThreads < numberOfThreads) {
+        throw std::invalid_argument("ThreadPool: maxThreads is less than numberOfThreads");
+    }
+
+    if (m_isLockFree) {
+        for (auto &lane : m_lockFreeLanes) {
+            lane = std::make_unique<MpmcQueue<Func>>(options.queueCapacity);
+        }
+    }
+
+    for (auto &lane : m_lanes) {
+        lane.setEarliestDeadlineFirst(options.earliestDeadlineFirst);
+    }
+
+    if (options.localQueues) {
+        for (size_t i = 0; i < m_maxNumberOfThreads; ++i) {
+            m_localQueues.emplace_back(std::make_unique<LocalQueue>());
+        }
+    }
 }
 
 ThreadPool::~ThreadPool()
@@ -38,17 +151,26 @@ void ThreadPool::run()
 
     m_isActive = true;
 
-    for (uint8_t i = 0; i < m_maxNumberOfThreads; ++i) {
-        m_threads.emplace_back(std::thread(std::bind(&ThreadPool::onThreadUpdate, this)));
+    for (size_t i = 0; i < m_numberOfThreads; ++i) {
+        spawnThread();
     }
 
-    while (m_aliveThreads < m_maxNumberOfThreads) {
+    while (m_aliveThreads < m_numberOfThreads) {
         std::this_thread::sleep_for(std::chrono::microseconds(1));
     }
+
+    if (isElastic()) {
+        m_controller = std::thread(std::bind(&ThreadPool::onControllerUpdate, this));
+    }
 }
 
 void ThreadPool::join()
 {
+    // controller exits first, after that set of threads does not change
+    if (m_controller.joinable()) {
+        m_controller.join();
+    }
+
     for (auto &thread : m_threads) {
         if (thread.joinable()) {
             thread.join();
@@ -58,14 +180,13 @@ void ThreadPool::join()
 
 void ThreadPool::interrupt()
 {
-    if (m_isActive) {
-        m_isActive = false;
-        m_condition.notify_all();
-    }
-
+    stopIntake();
     join();
 
     m_threads.clear();
+    m_exitedThreads.clear();
+    m_nextWorkerIndex = 0u;
+    m_retireRequests = 0u;
 }
 
 void ThreadPool::interruptImmediately()
@@ -74,20 +195,172 @@ void ThreadPool::interruptImmediately()
     interrupt();
 }
 
-void ThreadPool::onThreadUpdate()
+void ThreadPool::interruptImmediately(std::vector<Func> &unexecutedTasks)
+{
+    interruptImmediately();
+    takeTasks(unexecutedTasks);
+}
+
+size_t ThreadPool::drain()
+{
+    stopIntake();
+    const size_t result = getWorkload();
+    interrupt();
+    return result;
+}
+
+bool ThreadPool::waitForIdle(std::chrono::nanoseconds timeout)
+{
+    // registration as waiter goes before the check, see markIdle()
+    std::unique_lock<std::mutex> lock(m_idleMutex);
+    ++m_idleWaiters;
+    bool result = true;
+    if (timeout == std::chrono::nanoseconds::max()) {
+        m_idleCondition.wait(lock, [this]() { return isIdle(); });
+    } else {
+        result = m_idleCondition.wait_for(lock, timeout, [this]() { return isIdle(); });
+    }
+    --m_idleWaiters;
+    return result;
+}
+
+void ThreadPool::stopIntake()
+{
+    if (!m_isActive) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isActive = false;
+    }
+    m_eventCount.notifyAll();
+    m_spaceEventCount.notifyAll();
+
+    {
+        std::lock_guard<std::mutex> lock(m_controllerMutex);
+    }
+    m_controllerCondition.notify_all();
+}
+
+void ThreadPool::takeTasks(std::vector<Func> &tasks)
+{
+    // threads are joined, nobody else touches queues
+    for (size_t i = 0; i < m_lanes.size(); ++i) {
+        while (!m_lanes[i].empty()) {
+            tasks.emplace_back(std::move(m_lanes[i].front().fn));
+            m_lanes[i].pop();
+        }
+        updateQueueSize(i);
+    }
+
+    if (m_isLockFree) {
+        Func fn;
+        for (auto &lane : m_lockFreeLanes) {
+            while (lane->tryPop(fn)) {
+                tasks.emplace_back(std::move(fn));
+            }
+        }
+    }
+
+    for (auto &local : m_localQueues) {
+        while (!local->tasks.empty()) {
+            tasks.emplace_back(std::move(local->tasks.front()));
+            local->tasks.pop();
+        }
+        if (local->lifoSlot) {
+            tasks.emplace_back(std::move(local->lifoSlot));
+        }
+        local->size = 0u;
+    }
+    m_localQueuesSize = 0u;
+}
+
+bool ThreadPool::isIdle() const
+{
+    // queues are checked first: thread becomes busy before it takes a task, so taken task is seen either way
+    if (m_localQueuesSize > 0u) {
+        return false;
+    }
+
+    if (m_isLockFree) {
+        for (const auto &lane : m_lockFreeLanes) {
+            if (!lane->empty()) {
+                return false;
+            }
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queueSize.load(std::memory_order_relaxed)) {
+            return false;
+        }
+    }
+
+    return m_busyThreads == 0u;
+}
+
+void ThreadPool::markBusy()
+{
+    if (!t_isBusy) {
+        t_isBusy = true;
+        ++m_busyThreads;
+    }
+}
+
+void ThreadPool::markIdle()
+{
+    if (!t_isBusy) {
+        return;
+    }
+
+    t_isBusy = false;
+    // seq_cst decrement and load pair with registration of waiter, so either waiter sees idle pool or it is woken
+    if (--m_busyThreads == 0u && m_idleWaiters > 0u) {
+        std::lock_guard<std::mutex> lock(m_idleMutex);
+        m_idleCondition.notify_all();
+    }
+}
+
+void ThreadPool::onThreadUpdate(size_t index)
 {
     const auto threadId = std::this_thread::get_id();
     LOG_INFO("Start pool thread: " << threadId);
 
-    auto runThread = [this]() {
+    if (!m_cpuSets.empty() && !Topology::pinCurrentThread(m_cpuSets[index % m_cpuSets.size()])) {
+        LOG_ERROR("Could not pin pool thread: " << threadId);
+    }
+
+    Batch batch;
+    batch.tasks.reserve(m_maxBatchSize);
+    t_pool = this;
+    claimLocalQueue();
+
+    auto runThread = [this, &batch]() {
         ++m_aliveThreads;
 
+        if (m_isLockFree) {
+            while (m_isActive) {
+                triggerLockFree();
+                if (tryRetire()) {
+                    return;
+                }
+            }
+
+            while (!m_interruptImmediately && hasPendingTasks()) {
+                triggerLockFree();
+            }
+            return;
+        }
+
         while (m_isActive) {
-            trigger();
+            trigger(batch);
+            if (tryRetire()) {
+                return;
+            }
         }
 
-        while (!m_interruptImmediately && !m_queue.empty()) {
-            trigger();
+        while (!m_interruptImmediately && hasPendingTasks()) {
+            trigger(batch);
         }
     };
 
@@ -101,56 +374,1153 @@ void ThreadPool::onThreadUpdate()
     }
 
     ch.invoke(runThread);
+    markIdle();
     {
         std::lock_guard<std::mutex> lock(m_mutex);
         m_onCrashSubs.erase(m_onCrashSubs.find(threadId));
     }
+    releaseLocalQueue();
+    t_pool = nullptr;
+
+    // after crash give not executed part of batch to other threads
+    requeue(batch);
 
     --m_aliveThreads;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_exitedThreads.push_back(threadId);
+    }
 
     LOG_INFO("Exit pool thread: " << threadId);
 }
 
+void ThreadPool::onControllerUpdate()
+{
+    // hill climbing: number of threads keeps moving in the same direction while it pays off
+    const double GROWTH_GAIN = 1.05;
+    const double SHRINK_LOSS = 0.95;
+    const double intervalSec = std::chrono::duration<double>(m_controlInterval).count();
+
+    int direction = 1;
+    double lastThroughput = 0.0;
+    size_t minIdleThreads = std::numeric_limits<size_t>::max();
+    auto idleWindowStartTs = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(m_controllerMutex);
+    while (!m_controllerCondition.wait_for(lock, m_controlInterval, [this]() { return !m_isActive; })) {
+        reapExitedThreads();
+
+        const size_t threads = m_threads.size() - std::min(m_threads.size(), m_retireRequests.load());
+        // spinning and polling workers are idle as well, though only parked ones wait on event count
+        const size_t aliveThreads = m_aliveThreads.load();
+        const size_t idleThreads = aliveThreads - std::min(aliveThreads, m_busyThreads.load());
+        const double throughput = m_completedTasks.exchange(0u, std::memory_order_relaxed) / intervalSec;
+
+        size_t target = threads;
+        if (hasPendingTasks() && idleThreads == 0u) {
+            // growing must give noticeable gain, shrinking must not give noticeable loss
+            const bool isWorse = direction > 0 ? throughput < lastThroughput * GROWTH_GAIN
+                                               : throughput < lastThroughput * SHRINK_LOSS;
+            if (isWorse) {
+                direction = -direction;
+            }
+
+            target = direction > 0 ? std::min(threads + 1, m_maxNumberOfThreads)
+                                   : std::max(threads - std::min<size_t>(threads, 1u), m_numberOfThreads);
+            if (target == threads) {
+                direction = -direction;
+            }
+        }
+        lastThroughput = throughput;
+
+        // threads idle at every sample of the window are not needed
+        minIdleThreads = std::min(minIdleThreads, idleThreads);
+        const auto now = std::chrono::steady_clock::now();
+        if (now - idleWindowStartTs >= m_idleTimeout) {
+            if (minIdleThreads) {
+                target = std::max(target - std::min(target, minIdleThreads), m_numberOfThreads);
+            }
+            minIdleThreads = std::numeric_limits<size_t>::max();
+            idleWindowStartTs = now;
+        }
+
+        // crashed threads are replaced as well
+        target = std::max(target, m_numberOfThreads);
+        for (size_t i = threads; i < target; ++i) {
+            spawnThread();
+        }
+        if (target < threads) {
+            retireThreads(threads - target);
+        }
+    }
+}
+
+void ThreadPool::spawnThread()
+{
+    m_threads.emplace_back(std::thread(std::bind(&ThreadPool::onThreadUpdate, this, m_nextWorkerIndex++)));
+}
+
+void ThreadPool::retireThreads(size_t count)
+{
+    m_retireRequests += count;
+    wakeThreads(count);
+}
+
+bool ThreadPool::tryRetire()
+{
+    size_t requests = m_retireRequests.load(std::memory_order_relaxed);
+    while (requests) {
+        if (m_retireRequests.compare_exchange_weak(requests, requests - 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::reapExitedThreads()
+{
+    std::vector<std::thread::id> exitedThreads;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        exitedThreads.swap(m_exitedThreads);
+    }
+
+    for (const auto &threadId : exitedThreads) {
+        auto itr = std::find_if(m_threads.begin(), m_threads.end(), [&threadId](const auto &thread) {
+            return thread.get_id() == threadId;
+        });
+        if (itr != m_threads.end()) {
+            itr->join();
+            m_threads.erase(itr);
+        }
+    }
+}
+
+bool ThreadPool::isElastic() const
+{
+    return m_maxNumberOfThreads > m_numberOfThreads;
+}
+
+size_t ThreadPool::getNumberOfThreads() const
+{
+    return m_aliveThreads;
+}
+
 size_t ThreadPool::getWorkload() const
 {
-    return m_queue.size();
+    size_t result = m_localQueuesSize.load(std::memory_order_relaxed);
+    if (m_isLockFree) {
+        for (const auto &lane : m_lockFreeLanes) {
+            result += lane->size();
+        }
+        return result;
+    }
+
+    return result + m_queueSize.load(std::memory_order_relaxed);
+}
+
+size_t ThreadPool::getWorkload(Priority priority) const
+{
+    // tasks of local queues are NORMAL ones
+    const size_t lane = static_cast<size_t>(priority);
+    const size_t local = lane == NORMAL_LANE ? m_localQueuesSize.load(std::memory_order_relaxed) : 0u;
+    return local
+           + (m_isLockFree ? m_lockFreeLanes[lane]->size() : m_laneSizes[lane].load(std::memory_order_relaxed));
+}
+
+bool ThreadPool::hasPendingTasks() const
+{
+    return getWorkload() > 0u;
 }
 
 void ThreadPool::invoke(Func &&fn)
+{
+    invoke(std::forward<Func>(fn), Priority::NORMAL);
+}
+
+void ThreadPool::invoke(Func &&fn, Priority priority)
 {
     if (!isRunning()) {
         return;
     }
 
-    std::unique_lock<std::mutex> lock(m_mutex);
+    if (priority == Priority::NORMAL && tryPushLocal(fn)) {
+        return;
+    }
 
-    m_queue.emplace(std::forward<Func>(fn));
-    m_condition.notify_one();
+    const size_t lane = static_cast<size_t>(priority);
+    QueuedTask task {std::forward<Func>(fn), {}, timestamp()};
+    if (!tryPush(task, lane)) {
+        overflow(task, lane);
+    }
 }
 
-bool ThreadPool::isRunning()
+bool ThreadPool::tryInvoke(Func &&fn, Priority priority)
 {
-    return m_isActive;
+    if (!isRunning()) {
+        return false;
+    }
+
+    if (priority == Priority::NORMAL && tryPushLocal(fn)) {
+        return true;
+    }
+
+    QueuedTask task {std::forward<Func>(fn), {}, timestamp()};
+    if (tryPush(task, static_cast<size_t>(priority))) {
+        return true;
+    }
+
+    fn = std::move(task.fn);
+    m_rejectedTasks.fetch_add(1u, std::memory_order_relaxed);
+    return false;
 }
 
-void ThreadPool::trigger()
+size_t ThreadPool::getRejectedTasks() const
 {
-    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_rejectedTasks.load(std::memory_order_relaxed);
+}
+
+void ThreadPool::invokeSheddable(Func &&fn, Func &&onShed, Priority priority)
+{
+    if (!isRunning()) {
+        return;
+    }
 
-    if (m_aliveThreads) {
-        m_condition.wait(lock, [this]() { return !m_queue.empty() || !m_isActive; });
+    // local queues are not timestamped, so sheddable tasks always go to lanes
+    const size_t lane = static_cast<size_t>(priority);
+    QueuedTask task {.fn = std::forward<Func>(fn),
+                     .onDropped = std::forward<Func>(onShed),
+                     .enqueueTs = timestamp(),
+                     .isSheddable = true};
+    if (!tryPush(task, lane)) {
+        overflow(task, lane);
     }
+}
 
-    if (m_queue.empty()) {
+size_t ThreadPool::getShedTasks() const
+{
+    return m_shedTasks.load(std::memory_order_relaxed);
+}
+
+void ThreadPool::invoke(Func &&fn, Clock::time_point deadline, Func &&onExpired, Priority priority)
+{
+    if (!isRunning()) {
         return;
     }
 
-    auto fn = m_queue.front();
-    m_queue.pop();
+    if (m_isLockFree) {
+        // lock-free lanes keep bare tasks, so deadline and onExpired travel with the task
+        fn = DeadlineTask(this, std::move(fn), deadline, std::move(onExpired));
+    }
 
-    lock.unlock();
+    // local queues are not ordered by deadline, so such tasks always go to lanes
+    const size_t lane = static_cast<size_t>(priority);
+    QueuedTask task {.fn = std::forward<Func>(fn),
+                     .onDropped = std::forward<Func>(onExpired),
+                     .enqueueTs = timestamp(),
+                     .deadline = deadline};
+    if (!tryPush(task, lane)) {
+        overflow(task, lane);
+    }
+}
 
-    fn();
+size_t ThreadPool::getExpiredTasks() const
+{
+    return m_expiredTasks.load(std::memory_order_relaxed);
+}
+
+void ThreadPool::invoke(TenantId tenant, Func &&fn)
+{
+    if (!isRunning()) {
+        return;
+    }
+
+    // local queues are not shared fairly, so such tasks always go to lanes
+    QueuedTask task {.fn = std::forward<Func>(fn), .enqueueTs = timestamp(), .tenant = tenant};
+    if (!tryPush(task, NORMAL_LANE)) {
+        overflow(task, NORMAL_LANE);
+    }
+}
+
+void ThreadPool::setTenantWeight(TenantId tenant, size_t weight)
+{
+    if (!weight) {
+        throw std::invalid_argument("ThreadPool: tenant weight must be positive");
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &lane : m_lanes) {
+        lane.setTenantWeight(tenant, weight);
+    }
+}
+
+ThreadPool::TenantStats ThreadPool::getTenantStats(TenantId tenant) const
+{
+    TenantStats result;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &lane : m_lanes) {
+        const auto stats = lane.getTenantStats(tenant);
+        result.queued += stats.queued;
+        result.executed += stats.executed;
+    }
+    return result;
+}
+
+bool ThreadPool::isBounded() const
+{
+    return m_isLockFree || m_maxQueueSize;
+}
+
+bool ThreadPool::isFull(size_t lane) const
+{
+    // tasks of local queues are NORMAL ones, they take space of the bound as well
+    if (m_isLockFree) {
+        const auto &queue = *m_lockFreeLanes[lane];
+        const size_t local = lane == NORMAL_LANE ? m_localQueuesSize.load(std::memory_order_seq_cst) : 0u;
+        return queue.size() + local >= queue.capacity();
+    }
+
+    return m_maxQueueSize
+           && m_queueSize.load(std::memory_order_relaxed) + m_localQueuesSize.load(std::memory_order_seq_cst)
+                  >= m_maxQueueSize;
+}
+
+bool ThreadPool::tryPush(QueuedTask &task, size_t lane)
+{
+    if (m_isLockFree) {
+        if (lane == NORMAL_LANE && m_localQueuesSize.load(std::memory_order_relaxed) && isFull(lane)) {
+            return false;
+        }
+        if (!m_lockFreeLanes[lane]->tryPush(std::move(task.fn))) {
+            return false;
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (isFull(lane)) {
+            return false;
+        }
+        m_lanes[lane].emplace(std::move(task));
+        updateQueueSize(lane);
+    }
+
+    // no syscall unless some worker is parked
+    m_eventCount.notifyOne();
+    return true;
+}
+
+void ThreadPool::overflow(QueuedTask &task, size_t lane)
+{
+    // worker waiting for its own pool could wait forever
+    const auto policy =
+        m_overflowPolicy == OverflowPolicy::BLOCK && t_pool == this ? OverflowPolicy::CALLER_RUNS : m_overflowPolicy;
+
+    switch (policy) {
+    case OverflowPolicy::BLOCK:
+        while (!tryPush(task, lane)) {
+            if (!isRunning()) {
+                return;
+            }
+            waitForSpace(lane);
+        }
+        return;
+    case OverflowPolicy::REJECT:
+        reject(task);
+        return;
+    case OverflowPolicy::DROP_OLDEST:
+        dropOldest(task, lane);
+        return;
+    case OverflowPolicy::CALLER_RUNS:
+        m_rejectedTasks.fetch_add(1u, std::memory_order_relaxed);
+        task.fn();
+        return;
+    }
+}
+
+void ThreadPool::dropOldest(QueuedTask &task, size_t lane)
+{
+    if (m_isLockFree) {
+        while (!tryPush(task, lane)) {
+            // victim is destroyed right here, out of any lock
+            Func victim;
+            if (m_lockFreeLanes[lane]->tryPop(victim)) {
+                m_rejectedTasks.fetch_add(1u, std::memory_order_relaxed);
+            } else if (isFull(lane)) {
+                // space of lane is taken by local queues, their tasks are never dropped
+                reject(task);
+                return;
+            }
+            if (!isRunning()) {
+                return;
+            }
+        }
+        return;
+    }
+
+    // destructor or onShed of dropped task may invoke something on this pool, so they run after unlock
+    QueuedTask victim;
+    bool isQueued = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (isFull(lane)) {
+            size_t victimLane = PRIORITIES_COUNT;
+            for (size_t i = PRIORITIES_COUNT; i-- > lane;) {
+                if (!m_lanes[i].empty()) {
+                    victimLane = i;
+                    break;
+                }
+            }
+
+            if (victimLane == PRIORITIES_COUNT) {
+                // queue is full of more important tasks
+                victim = std::move(task);
+            } else {
+                victim = m_lanes[victimLane].takeVictim();
+                updateQueueSize(victimLane);
+            }
+        }
+
+        if (task.fn) {
+            m_lanes[lane].emplace(std::move(task));
+            updateQueueSize(lane);
+            isQueued = true;
+        }
+    }
+
+    if (victim.fn) {
+        reject(victim);
+    }
+    if (isQueued) {
+        m_eventCount.notifyOne();
+    }
+}
+
+void ThreadPool::reject(QueuedTask &task)
+{
+    m_rejectedTasks.fetch_add(1u, std::memory_order_relaxed);
+    if (task.onDropped) {
+        task.onDropped();
+    }
+}
+
+bool ThreadPool::hasSpace(size_t lane)
+{
+    if (m_isLockFree) {
+        // seq_cst loads of queue positions
+        return !isFull(lane);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !isFull(lane);
+}
+
+void ThreadPool::waitForSpace(size_t lane)
+{
+    // same handshake as in park(): consumers take tasks before they look for blocked producers
+    const auto key = m_spaceEventCount.prepareWait();
+    if (hasSpace(lane) || !m_isActive) {
+        m_spaceEventCount.cancelWait();
+        return;
+    }
+    m_spaceEventCount.commitWait(key);
+}
+
+void ThreadPool::invokeBatch(std::span<Func> tasks)
+{
+    if (!isRunning() || tasks.empty()) {
+        return;
+    }
+
+    if (isBounded()) {
+        // every task is pushed and woken separately, so nobody sleeps on part of batch while producer waits
+        for (auto &fn : tasks) {
+            QueuedTask task {std::move(fn), {}, timestamp()};
+            if (!tryPush(task, NORMAL_LANE)) {
+                overflow(task, NORMAL_LANE);
+            }
+        }
+        return;
+    }
+
+    const auto enqueueTs = timestamp();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto &fn : tasks) {
+            m_lanes[NORMAL_LANE].emplace(QueuedTask {std::move(fn), {}, enqueueTs});
+        }
+        updateQueueSize(NORMAL_LANE);
+    }
+    wakeThreads(tasks.size());
+}
+
+void ThreadPool::updateQueueSize(size_t lane)
+{
+    m_laneSizes[lane].store(m_lanes[lane].size(), std::memory_order_relaxed);
+
+    size_t queueSize = 0u;
+    for (const auto &queue : m_lanes) {
+        queueSize += queue.size();
+    }
+    m_queueSize.store(queueSize, std::memory_order_relaxed);
+}
+
+void ThreadPool::wakeThreads(size_t tasksCount)
+{
+    m_eventCount.notify(tasksCount);
+}
+
+bool ThreadPool::canResume()
+{
+    // seq_cst load pairs with increment in pushLocal()
+    if (m_localQueuesSize > 0u) {
+        return true;
+    }
+
+    if (m_isLockFree) {
+        // seq_cst loads of queue positions and m_isActive
+        for (const auto &lane : m_lockFreeLanes) {
+            if (!lane->empty()) {
+                return true;
+            }
+        }
+        return !m_isActive || m_retireRequests > 0u;
+    }
+
+    // producers publish under the mutex before they look for waiters
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &lane : m_lanes) {
+        if (!lane.empty()) {
+            return true;
+        }
+    }
+    return !m_isActive || m_retireRequests > 0u;
+}
+
+void ThreadPool::park()
+{
+    // registration as waiter goes before the last check, so concurrent producer either sees the waiter
+    // and bumps the epoch, or its task is seen by the check
+    const auto key = m_eventCount.prepareWait();
+    if (canResume()) {
+        m_eventCount.cancelWait();
+        return;
+    }
+    m_eventCount.commitWait(key);
+}
+
+bool ThreadPool::isRunning()
+{
+    return m_isActive;
+}
+
+size_t ThreadPool::selectLane()
+{
+    const auto &critical = m_lanes[CRITICAL_LANE];
+    const auto &normal = m_lanes[NORMAL_LANE];
+
+    if (!critical.empty() && (normal.empty() || m_bypassedTasks < m_agingLimit)) {
+        if (!normal.empty()) {
+            ++m_bypassedTasks;
+        }
+        return CRITICAL_LANE;
+    }
+
+    if (!normal.empty()) {
+        m_bypassedTasks = 0u;
+        return NORMAL_LANE;
+    }
+
+    if (!m_lanes[BACKGROUND_LANE].empty()) {
+        return BACKGROUND_LANE;
+    }
+
+    return PRIORITIES_COUNT;
+}
+
+void ThreadPool::trigger(Batch &batch)
+{
+    markBusy();
+
+    Func local;
+    if (tryPopLifo(local)) {
+        runTask(local);
+        return;
+    }
+
+    auto hasWork = [this]() {
+        return m_queueSize.load(std::memory_order_relaxed) > 0u
+               || m_localQueuesSize.load(std::memory_order_relaxed) > 0u || !m_isActive || m_retireRequests > 0u;
+    };
+    if (!hasWork()) {
+        // no task is held while spinning or parked
+        markIdle();
+        if (!spinUntil(m_idlePolicy, m_spinLimit, hasWork) && m_idlePolicy != IdlePolicy::BUSY_POLL) {
+            park();
+        }
+        markBusy();
+    }
+
+    if (!takeBatch(batch, m_maxBatchSize)) {
+        if (tryPopLocal(local)) {
+            runTask(local);
+        } else {
+            markIdle();
+        }
+        return;
+    }
+
+    for (auto &fn : batch.tasks) {
+        if (m_interruptImmediately) {
+            break;
+        }
+        // slot is emptied before call, so crash leaves only not executed tasks in batch
+        auto task = std::move(fn);
+        task();
+    }
+    if (isElastic()) {
+        m_completedTasks.fetch_add(batch.tasks.size(), std::memory_order_relaxed);
+    }
+    // not executed part of batch is requeued when thread exits
+    std::erase_if(batch.tasks, [](const auto &fn) { return !fn; });
+}
+
+bool ThreadPool::takeBatch(Batch &batch, size_t maxBatchSize)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const size_t lane = selectLane();
+    if (lane == PRIORITIES_COUNT) {
+        return false;
+    }
+
+    // batch is taken from single lane, fair share of its backlog, but no more than configured limit
+    auto &queue = m_lanes[lane];
+    const size_t workers = std::max<size_t>(m_aliveThreads, 1u);
+    const size_t batchSize = std::clamp<size_t>(queue.size() / workers, 1u, maxBatchSize);
+    const size_t queueSize = queue.size();
+    auto now = timestamp();
+    while (batch.tasks.size() < batchSize && !queue.empty()) {
+        auto &task = queue.front();
+        if (task.deadline != Clock::time_point::max()) {
+            now = now == Clock::time_point() ? Clock::now() : now;
+            if (task.deadline < now) {
+                m_expiredTasks.fetch_add(1u, std::memory_order_relaxed);
+                batch.droppedTasks.emplace_back(std::move(task));
+                queue.pop();
+                continue;
+            }
+        }
+
+        // every task is a sample of queue delay, dropped ones do not count to batch
+        if (m_targetDelay.count() && isOverloaded(now, now - task.enqueueTs) && task.isSheddable) {
+            m_shedTasks.fetch_add(1u, std::memory_order_relaxed);
+            batch.droppedTasks.emplace_back(std::move(task));
+        } else {
+            queue.countExecuted();
+            batch.tasks.emplace_back(std::move(task.fn));
+        }
+        queue.pop();
+    }
+    batch.priority = static_cast<Priority>(lane);
+    const size_t takenCount = queueSize - queue.size();
+    updateQueueSize(lane);
+
+    lock.unlock();
+    if (m_maxQueueSize) {
+        m_spaceEventCount.notify(takenCount);
+    }
+    notifyDropped(batch);
+    return true;
+}
+
+void ThreadPool::requeue(Batch &batch)
+{
+    const size_t lane = static_cast<size_t>(batch.priority);
+    size_t count = 0u;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto &fn : batch.tasks) {
+            if (fn) {
+                m_lanes[lane].emplace(QueuedTask {std::move(fn), {}, timestamp()});
+                ++count;
+            }
+        }
+        updateQueueSize(lane);
+        batch.tasks.clear();
+    }
+
+    if (count) {
+        wakeThreads(count);
+    }
+}
+
+bool ThreadPool::tryPopLockFree(Func &fn)
+{
+    auto &critical = *m_lockFreeLanes[CRITICAL_LANE];
+    auto &normal = *m_lockFreeLanes[NORMAL_LANE];
+
+    // counter is shared by consumers without lock, so aging is approximate here
+    if (m_bypassedTasks.load(std::memory_order_relaxed) >= m_agingLimit && normal.tryPop(fn)) {
+        m_bypassedTasks.store(0u, std::memory_order_relaxed);
+        return true;
+    }
+
+    if (critical.tryPop(fn)) {
+        if (!normal.empty()) {
+            m_bypassedTasks.fetch_add(1u, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    if (normal.tryPop(fn)) {
+        m_bypassedTasks.store(0u, std::memory_order_relaxed);
+        return true;
+    }
+
+    return m_lockFreeLanes[BACKGROUND_LANE]->tryPop(fn);
+}
+
+void ThreadPool::triggerLockFree()
+{
+    markBusy();
+
+    Func fn;
+    if (tryPopLifo(fn)) {
+        runTask(fn);
+        return;
+    }
+    if (tryPopLockFree(fn)) {
+        // producers of different lanes may wait, so all of them recheck
+        m_spaceEventCount.notifyAll();
+        runTask(fn);
+        return;
+    }
+    if (tryPopLocal(fn)) {
+        runTask(fn);
+        return;
+    }
+
+    markIdle();
+    if (!m_isActive) {
+        return;
+    }
+
+    const bool hasWork = spinUntil(m_idlePolicy, m_spinLimit, [this]() {
+        return hasPendingTasks() || !m_isActive || m_retireRequests > 0u;
+    });
+    if (hasWork || m_idlePolicy == IdlePolicy::BUSY_POLL) {
+        return;
+    }
+
+    park();
+}
+
+ThreadPool::Clock::time_point ThreadPool::timestamp() const
+{
+    return m_targetDelay.count() ? Clock::now() : Clock::time_point();
+}
+
+bool ThreadPool::isOverloaded(Clock::time_point now, Clock::duration delay)
+{
+    // state of the interval is switched by the first dequeue after its end, interval without samples is not overloaded
+    if (now >= m_delayIntervalEndTs) {
+        m_isOverloaded = m_minDelay != Clock::duration::max() && m_minDelay > m_targetDelay;
+        m_minDelay = Clock::duration::max();
+        m_delayIntervalEndTs = now + m_delayInterval;
+    }
+
+    m_minDelay = std::min(m_minDelay, delay);
+    return m_isOverloaded && delay > 2 * m_targetDelay;
+}
+
+void ThreadPool::notifyDropped(Batch &batch)
+{
+    for (auto &task : batch.droppedTasks) {
+        if (task.onDropped) {
+            task.onDropped();
+        }
+    }
+    batch.droppedTasks.clear();
+}
+
+bool ThreadPool::isWorkerThread() const
+{
+    return t_pool == this;
+}
+
+bool ThreadPool::runPendingTask()
+{
+    if (t_pool != this) {
+        return false;
+    }
+
+    // own spawned tasks first, they are the most likely ones the caller waits for
+    Func fn;
+    if (tryPopLifo(fn) || tryPopLocal(fn)) {
+        runTask(fn);
+        return true;
+    }
+
+    if (m_isLockFree) {
+        if (!tryPopLockFree(fn)) {
+            return false;
+        }
+        m_spaceEventCount.notifyAll();
+        runTask(fn);
+        return true;
+    }
+
+    Batch batch;
+    if (!takeBatch(batch, 1u)) {
+        return false;
+    }
+    for (auto &task : batch.tasks) {
+        runTask(task);
+    }
+    return true;
+}
+
+void ThreadPool::runTask(Func &fn)
+{
+    fn();
+    if (isElastic()) {
+        m_completedTasks.fetch_add(1u, std::memory_order_relaxed);
+    }
+}
+
+void ThreadPool::claimLocalQueue()
+{
+    LocalQueue *queue = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_localQueues.size(); ++i) {
+            if (!m_localQueues[i]->isClaimed) {
+                m_localQueues[i]->isClaimed = true;
+                t_localQueue = i;
+                t_lifoStreak = 0u;
+                queue = m_localQueues[i].get();
+                break;
+            }
+        }
+    }
+
+    if (queue) {
+        // does nothing once queue has storage, queues of threads which never run are not allocated
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->tasks.reserve(LOCAL_QUEUE_RESERVE);
+    }
+}
+
+void ThreadPool::releaseLocalQueue()
+{
+    if (!hasLocalQueue()) {
+        return;
+    }
+
+    // tasks left in queue are stolen by other workers or taken by next owner
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_localQueues[t_localQueue]->isClaimed = false;
+    t_localQueue = NO_LOCAL_QUEUE;
+}
+
+bool ThreadPool::hasLocalQueue() const
+{
+    return t_pool == this && t_localQueue != NO_LOCAL_QUEUE;
+}
+
+bool ThreadPool::tryPushLocal(Func &fn)
+{
+    // bound is checked without pool mutex, concurrent workers may exceed it by one task each
+    if (!hasLocalQueue() || (isBounded() && isFull(NORMAL_LANE))) {
+        return false;
+    }
+
+    pushLocal(std::move(fn));
+    return true;
+}
+
+void ThreadPool::pushLocal(Func &&fn)
+{
+    auto &local = *m_localQueues[t_localQueue];
+    {
+        std::lock_guard<std::mutex> lock(local.mutex);
+        if (local.lifoSlot) {
+            local.tasks.emplace(std::move(local.lifoSlot));
+        }
+        local.lifoSlot = std::move(fn);
+        local.size.fetch_add(1u, std::memory_order_relaxed);
+        m_localQueuesSize.fetch_add(1u, std::memory_order_seq_cst);
+    }
+    // idle worker may steal it, no syscall unless some worker is parked
+    m_eventCount.notifyOne();
+}
+
+bool ThreadPool::tryPopLifo(Func &fn)
+{
+    if (!hasLocalQueue()) {
+        return false;
+    }
+
+    if (t_lifoStreak >= MAX_LIFO_STREAK) {
+        t_lifoStreak = 0u;
+        return false;
+    }
+
+    auto &local = *m_localQueues[t_localQueue];
+    if (local.size.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(local.mutex);
+        if (local.lifoSlot) {
+            fn = std::move(local.lifoSlot);
+            local.size.fetch_sub(1u, std::memory_order_relaxed);
+            m_localQueuesSize.fetch_sub(1u, std::memory_order_seq_cst);
+            notifySpace();
+            ++t_lifoStreak;
+            return true;
+        }
+    }
+
+    t_lifoStreak = 0u;
+    return false;
+}
+
+bool ThreadPool::tryPopLocal(Func &fn)
+{
+    if (!m_localQueuesSize.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    // own queue first, then the others starting from the next one, so thieves do not pile up on single victim
+    const size_t own = hasLocalQueue() ? t_localQueue : 0u;
+    for (size_t i = 0; i < m_localQueues.size(); ++i) {
+        auto &local = *m_localQueues[(own + i) % m_localQueues.size()];
+        if (local.size.load(std::memory_order_relaxed) && tryPopFrom(local, fn)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::tryPopFrom(LocalQueue &local, Func &fn)
+{
+    // the oldest task first, LIFO slot is taken only when nothing else is left
+    std::lock_guard<std::mutex> lock(local.mutex);
+    if (!local.tasks.empty()) {
+        fn = std::move(local.tasks.front());
+        local.tasks.pop();
+    } else if (local.lifoSlot) {
+        fn = std::move(local.lifoSlot);
+    } else {
+        return false;
+    }
+
+    local.size.fetch_sub(1u, std::memory_order_relaxed);
+    m_localQueuesSize.fetch_sub(1u, std::memory_order_seq_cst);
+    notifySpace();
+    return true;
+}
+
+void ThreadPool::notifySpace()
+{
+    // seq_cst decrement of local queues size pairs with isFull() of blocked producer
+    if (m_isLockFree) {
+        // producers of different lanes may wait, so all of them recheck
+        m_spaceEventCount.notifyAll();
+    } else if (m_maxQueueSize) {
+        m_spaceEventCount.notifyOne();
+    }
+}
+
+void ThreadPool::TaskQueue::setEarliestDeadlineFirst(bool isEarliestDeadlineFirst)
+{
+    m_isEarliestDeadlineFirst = isEarliestDeadlineFirst;
+}
+
+void ThreadPool::TaskQueue::emplace(QueuedTask &&task)
+{
+    if (!m_isEarliestDeadlineFirst) {
+        m_fifo.emplace(std::move(task));
+        return;
+    }
+
+    const auto deadline = task.deadline;
+    size_t slot = m_slots.size();
+    if (m_freeSlots.empty()) {
+        m_slots.emplace_back(std::move(task));
+    } else {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        m_slots[slot] = std::move(task);
+    }
+    m_heap.emplace(DeadlineKey {deadline, m_sequence++, slot});
+}
+
+ThreadPool::QueuedTask &ThreadPool::TaskQueue::front()
+{
+    return m_isEarliestDeadlineFirst ? m_slots[m_heap.top().slot] : m_fifo.front();
+}
+
+void ThreadPool::TaskQueue::pop()
+{
+    if (!m_isEarliestDeadlineFirst) {
+        m_fifo.pop();
+        return;
+    }
+
+    const size_t slot = m_heap.top().slot;
+    m_slots[slot] = QueuedTask();
+    m_freeSlots.emplace_back(slot);
+    m_heap.pop();
+}
+
+ThreadPool::QueuedTask ThreadPool::TaskQueue::takeVictim()
+{
+    if (!m_isEarliestDeadlineFirst) {
+        auto victim = std::move(m_fifo.front());
+        m_fifo.pop();
+        return victim;
+    }
+
+    // linear scan, overflow is not a hot path
+    size_t index = 0u;
+    for (size_t i = 1; i < m_heap.size(); ++i) {
+        const auto &key = m_heap[i];
+        const auto &least = m_heap[index];
+        if (key.deadline > least.deadline || (key.deadline == least.deadline && key.sequence < least.sequence)) {
+            index = i;
+        }
+    }
+
+    const size_t slot = m_heap[index].slot;
+    auto victim = std::move(m_slots[slot]);
+    m_slots[slot] = QueuedTask();
+    m_freeSlots.emplace_back(slot);
+    m_heap.erase(index);
+    return victim;
+}
+
+size_t ThreadPool::TaskQueue::size() const
+{
+    return m_isEarliestDeadlineFirst ? m_heap.size() : m_fifo.size();
+}
+
+bool ThreadPool::TaskQueue::empty() const
+{
+    return size() == 0u;
+}
+
+ThreadPool::Lane::Lane()
+{
+    m_tenants.emplace_back();
+}
+
+void ThreadPool::Lane::setEarliestDeadlineFirst(bool isEarliestDeadlineFirst)
+{
+    m_isEarliestDeadlineFirst = isEarliestDeadlineFirst;
+    for (auto &tenant : m_tenants) {
+        tenant.queue.setEarliestDeadlineFirst(isEarliestDeadlineFirst);
+    }
+}
+
+void ThreadPool::Lane::setTenantWeight(TenantId id, size_t weight)
+{
+    // new weight applies from the next turn of tenant
+    tenant(id).weight = weight;
+}
+
+ThreadPool::TenantStats ThreadPool::Lane::getTenantStats(TenantId id) const
+{
+    if (id == DEFAULT_TENANT) {
+        return {m_tenants.front().queue.size(), m_tenants.front().executed};
+    }
+
+    const auto itr = m_tenantIndexes.find(id);
+    if (itr == m_tenantIndexes.end()) {
+        return {};
+    }
+    const auto &tenant = m_tenants[itr->second];
+    return {tenant.queue.size(), tenant.executed};
+}
+
+ThreadPool::Lane::Tenant &ThreadPool::Lane::tenant(TenantId id)
+{
+    if (id == DEFAULT_TENANT) {
+        return m_tenants.front();
+    }
+
+    const auto [itr, isAdded] = m_tenantIndexes.try_emplace(id, m_tenants.size());
+    if (isAdded) {
+        m_tenants.emplace_back().queue.setEarliestDeadlineFirst(m_isEarliestDeadlineFirst);
+    }
+    return m_tenants[itr->second];
+}
+
+void ThreadPool::Lane::emplace(QueuedTask &&task)
+{
+    auto &owner = tenant(task.tenant);
+    if (owner.queue.empty()) {
+        owner.deficit = owner.weight;
+        m_activeTenants.emplace(static_cast<size_t>(&owner - m_tenants.data()));
+    }
+    owner.queue.emplace(std::move(task));
+    ++m_size;
+}
+
+ThreadPool::QueuedTask &ThreadPool::Lane::front()
+{
+    return m_tenants[m_activeTenants.front()].queue.front();
+}
+
+void ThreadPool::Lane::countExecuted()
+{
+    ++m_tenants[m_activeTenants.front()].executed;
+}
+
+void ThreadPool::Lane::pop()
+{
+    const size_t index = m_activeTenants.front();
+    auto &owner = m_tenants[index];
+    owner.queue.pop();
+    --m_size;
+
+    if (owner.queue.empty()) {
+        // idle tenant does not keep deficit for later
+        m_activeTenants.pop();
+        owner.deficit = 0u;
+    } else if (--owner.deficit == 0u) {
+        owner.deficit = owner.weight;
+        if (m_activeTenants.size() > 1u) {
+            m_activeTenants.pop();
+            m_activeTenants.emplace(index);
+        }
+    }
+}
+
+ThreadPool::QueuedTask ThreadPool::Lane::takeVictim()
+{
+    // tenant being served wins ties, so the queue of any other tenant keeps at least one task and stays in the ring
+    size_t index = m_activeTenants.front();
+    for (size_t i = 0; i < m_tenants.size(); ++i) {
+        if (m_tenants[i].queue.size() > m_tenants[index].queue.size()) {
+            index = i;
+        }
+    }
+
+    auto &owner = m_tenants[index];
+    auto victim = owner.queue.takeVictim();
+    --m_size;
+    if (owner.queue.empty()) {
+        m_activeTenants.pop();
+        owner.deficit = 0u;
+    }
+    return victim;
+}
+
+size_t ThreadPool::Lane::size() const
+{
+    return m_size;
+}
+
+bool ThreadPool::Lane::empty() const
+{
+    return m_size == 0u;
 }
 
-} // namespace psi::thread
\ No newline at end of file
+} // namespace psi::thread
@@ -2,6 +2,11 @@
 #include "psi/thread/ThreadPoolQueued.h"
 #include "psi/thread/CrashHandler.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+
 #ifdef PSI_LOGGER
 #include "psi/logger/Logger.h"
 #else
@@ -18,10 +23,58 @@
 
 namespace psi::thread {
 
-ThreadPoolQueued::SimpleThread::SimpleThread()
-    : m_isActive(false)
+namespace {
+thread_local const ThreadPoolQueued *t_pool = nullptr;
+thread_local uint64_t t_randomState = 0u;
+
+/// Lamping & Veach: bucket in [0, buckets), growing buckets count moves only 1/buckets of keys
+size_t jumpConsistentHash(uint64_t key, size_t buckets)
+{
+    int64_t bucket = -1;
+    int64_t next = 0;
+    while (next < static_cast<int64_t>(buckets)) {
+        bucket = next;
+        key = key * 2862933555777941757ull + 1u;
+        next = static_cast<int64_t>((bucket + 1) * (double(1ll << 31) / double((key >> 33) + 1)));
+    }
+    return static_cast<size_t>(bucket);
+}
+
+/// xorshift64*, every thread has its own sequence
+size_t nextRandom()
+{
+    if (!t_randomState) {
+        t_randomState = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1u;
+    }
+    t_randomState ^= t_randomState >> 12;
+    t_randomState ^= t_randomState << 25;
+    t_randomState ^= t_randomState >> 27;
+    return static_cast<size_t>(t_randomState * 0x2545f4914f6cdd1dull);
+}
+
+/// splitmix64 finalizer, next probe for key whose thread is crashed
+uint64_t mixKey(uint64_t key)
+{
+    key += 0x9e3779b97f4a7c15ull;
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ull;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111ebull;
+    return key ^ (key >> 31);
+}
+} // namespace
+
+ThreadPoolQueued::SimpleThread::SimpleThread(ThreadPoolQueued &pool, const Options &options, size_t index)
+    : m_pool(pool)
+    , m_isLockFree(options.queueBackend == QueueBackend::LOCK_FREE)
+    , m_maxBatchSize(std::max<size_t>(options.maxBatchSize, 1u))
+    , m_idlePolicy(options.idlePolicy)
+    , m_spinLimit(options.spinLimit)
+    , m_cpus(options.cpuSets.empty() ? CpuSet() : options.cpuSets[index % options.cpuSets.size()])
+    , m_queueCapacity(m_isLockFree ? 0u : options.queueCapacity)
+    , m_overflowPolicy(options.overflowPolicy)
+    , m_isActive(false)
     , m_interruptImmediately(false)
 {
+    m_batch.reserve(m_maxBatchSize);
 }
 
 ThreadPoolQueued::SimpleThread::~SimpleThread()
@@ -41,13 +94,50 @@ void ThreadPoolQueued::SimpleThread::run()
 }
 
 void ThreadPoolQueued::SimpleThread::interrupt()
+{
+    stopIntake();
+    join();
+}
+
+void ThreadPoolQueued::SimpleThread::stopIntake()
 {
     if (m_isActive) {
-        m_isActive = false;
-        m_condition.notify_all();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isActive = false;
+        }
+        m_eventCount.notifyAll();
+        m_spaceEventCount.notifyAll();
+    }
+}
+
+void ThreadPoolQueued::SimpleThread::takeTasks(std::vector<Func> &tasks)
+{
+    // executed part of batch is left empty by crash
+    for (auto &fn : m_batch) {
+        if (fn) {
+            tasks.emplace_back(std::move(fn));
+        }
     }
+    m_batch.clear();
 
-    join();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (!m_queue.empty()) {
+        tasks.emplace_back(std::move(m_queue.front()));
+        m_queue.pop();
+    }
+    // task which is still being linked by its producer keeps being counted
+    Func fn;
+    size_t taken = 0u;
+    while (m_lockFreeQueue.tryPop(fn)) {
+        tasks.emplace_back(std::move(fn));
+        ++taken;
+    }
+    if (m_isLockFree) {
+        m_queueSize.fetch_sub(taken, std::memory_order_seq_cst);
+    } else {
+        m_queueSize = 0u;
+    }
 }
 
 void ThreadPoolQueued::SimpleThread::interruptImmediately()
@@ -68,9 +158,49 @@ bool ThreadPoolQueued::SimpleThread::isRunning()
     return m_isActive;
 }
 
+bool ThreadPoolQueued::SimpleThread::isIdle()
+{
+    if (m_isLockFree) {
+        // thread becomes busy before it takes a task and decrements counter
+        return !m_queueSize.load(std::memory_order_seq_cst) && !m_isBusy;
+    }
+
+    // thread becomes busy before it takes a task under the same lock
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queue.empty() && !m_isBusy;
+}
+
+void ThreadPoolQueued::SimpleThread::markBusy()
+{
+    if (!m_isBusy.load(std::memory_order_relaxed)) {
+        m_isBusy = true;
+    }
+}
+
+void ThreadPoolQueued::SimpleThread::markIdle()
+{
+    if (m_isBusy.load(std::memory_order_relaxed)) {
+        m_isBusy = false;
+        m_pool.notifyIdle();
+    }
+}
+
 size_t ThreadPoolQueued::SimpleThread::getWorkload() const
 {
-    return m_queue.size();
+    return m_queueSize.load(std::memory_order_relaxed);
+}
+
+size_t ThreadPoolQueued::SimpleThread::getLoad() const
+{
+    if (!m_isActive) {
+        return std::numeric_limits<size_t>::max();
+    }
+    return m_queueSize.load(std::memory_order_relaxed) + m_batchLoad.load(std::memory_order_relaxed);
+}
+
+size_t ThreadPoolQueued::SimpleThread::getRejectedTasks() const
+{
+    return m_rejectedTasks.load(std::memory_order_relaxed);
 }
 
 void ThreadPoolQueued::SimpleThread::invoke(Func &&fn)
@@ -79,15 +209,162 @@ void ThreadPoolQueued::SimpleThread::invoke(Func &&fn)
         return;
     }
 
-    std::unique_lock<std::mutex> lock(m_mutex);
-    m_queue.emplace(fn);
-    m_condition.notify_one();
+    if (!tryPush(fn)) {
+        overflow(fn);
+    }
+}
+
+bool ThreadPoolQueued::SimpleThread::tryInvoke(Func &&fn)
+{
+    if (!isRunning()) {
+        return false;
+    }
+
+    if (tryPush(fn)) {
+        return true;
+    }
+
+    m_rejectedTasks.fetch_add(1u, std::memory_order_relaxed);
+    return false;
+}
+
+bool ThreadPoolQueued::SimpleThread::tryPush(Func &fn)
+{
+    if (m_isLockFree) {
+        m_queueSize.fetch_add(1u, std::memory_order_seq_cst);
+        m_lockFreeQueue.push(std::move(fn));
+        m_eventCount.notifyOne();
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queueCapacity && m_queue.size() >= m_queueCapacity) {
+            return false;
+        }
+        m_queue.emplace(std::move(fn));
+        m_queueSize.store(m_queue.size(), std::memory_order_relaxed);
+    }
+    // no syscall while thread is busy
+    m_eventCount.notifyOne();
+    return true;
+}
+
+void ThreadPoolQueued::SimpleThread::overflow(Func &fn)
+{
+    // thread waiting for its own pool could wait forever
+    const auto policy = m_overflowPolicy == OverflowPolicy::BLOCK && t_pool == &m_pool ? OverflowPolicy::CALLER_RUNS
+                                                                                        : m_overflowPolicy;
+
+    switch (policy) {
+    case OverflowPolicy::BLOCK:
+        while (!tryPush(fn)) {
+            if (!isRunning()) {
+                return;
+            }
+            waitForSpace();
+        }
+        return;
+    case OverflowPolicy::REJECT:
+        m_rejectedTasks.fetch_add(1u, std::memory_order_relaxed);
+        return;
+    case OverflowPolicy::DROP_OLDEST: {
+        // destructor of dropped task may invoke something on this thread, so it runs after unlock
+        Func victim;
+        m_rejectedTasks.fetch_add(1u, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_queue.size() >= m_queueCapacity) {
+                victim = std::move(m_queue.front());
+                m_queue.pop();
+            }
+            m_queue.emplace(std::move(fn));
+            m_queueSize.store(m_queue.size(), std::memory_order_relaxed);
+        }
+        m_eventCount.notifyOne();
+        return;
+    }
+    case OverflowPolicy::CALLER_RUNS:
+        m_rejectedTasks.fetch_add(1u, std::memory_order_relaxed);
+        fn();
+        return;
+    }
+}
+
+void ThreadPoolQueued::SimpleThread::waitForSpace()
+{
+    // same handshake as in park(), thread takes tasks before it looks for blocked producers
+    const auto key = m_spaceEventCount.prepareWait();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queue.size() < m_queueCapacity || !m_isActive) {
+            m_spaceEventCount.cancelWait();
+            return;
+        }
+    }
+    m_spaceEventCount.commitWait(key);
+}
+
+void ThreadPoolQueued::SimpleThread::invokeBatch(std::span<Func> tasks)
+{
+    if (!isRunning()) {
+        return;
+    }
+
+    if (m_queueCapacity) {
+        for (auto &fn : tasks) {
+            invoke(std::move(fn));
+        }
+        return;
+    }
+
+    if (m_isLockFree) {
+        m_queueSize.fetch_add(tasks.size(), std::memory_order_seq_cst);
+        for (auto &fn : tasks) {
+            m_lockFreeQueue.push(std::move(fn));
+        }
+        m_eventCount.notifyOne();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto &fn : tasks) {
+            m_queue.emplace(std::move(fn));
+        }
+        m_queueSize.store(m_queue.size(), std::memory_order_relaxed);
+    }
+    m_eventCount.notifyOne();
+}
+
+void ThreadPoolQueued::SimpleThread::park()
+{
+    // waiter is registered before the last check, see ThreadPool::park()
+    const auto key = m_eventCount.prepareWait();
+    if (m_isLockFree) {
+        if (m_queueSize.load(std::memory_order_seq_cst) || !m_isActive) {
+            m_eventCount.cancelWait();
+            return;
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_queue.empty() || !m_isActive) {
+            m_eventCount.cancelWait();
+            return;
+        }
+    }
+    m_eventCount.commitWait(key);
 }
 
 void ThreadPoolQueued::SimpleThread::onThreadUpdate()
 {
     LOG_INFO("Start pool queued thread: " << std::this_thread::get_id());
 
+    if (!m_cpus.empty() && !Topology::pinCurrentThread(m_cpus)) {
+        LOG_ERROR("Could not pin pool queued thread: " << std::this_thread::get_id());
+    }
+    t_pool = &m_pool;
+
     psi::thread::CrashHandler ch;
     auto crashSub = ch.crashEvent().subscribe([this](const auto &error, const auto &stacktrace) {
         m_isActive = false;
@@ -98,12 +375,13 @@ void ThreadPoolQueued::SimpleThread::onThreadUpdate()
             trigger();
         }
 
-        while (!m_interruptImmediately && !m_queue.empty()) {
+        while (!m_interruptImmediately && m_queueSize.load(std::memory_order_acquire)) {
             trigger();
         }
     });
 
     m_isActive = false;
+    markIdle();
 
     LOG_INFO("Exit pool queued thread: " << std::this_thread::get_id());
 }
@@ -115,23 +393,81 @@ ThreadPoolQueued::SimpleThread::OnCrashEvent::Interface &ThreadPoolQueued::Simpl
 
 void ThreadPoolQueued::SimpleThread::trigger()
 {
-    std::unique_lock<std::mutex> lock(m_mutex);
-    m_condition.wait(lock, [this]() { return !m_queue.empty() || !m_isActive; });
+    markBusy();
+
+    auto hasWork = [this]() {
+        return m_queueSize.load(std::memory_order_relaxed) > 0u || !m_isActive;
+    };
+    if (!hasWork()) {
+        // no task is held while spinning or parked
+        markIdle();
+        if (!spinUntil(m_idlePolicy, m_spinLimit, hasWork) && m_idlePolicy != IdlePolicy::BUSY_POLL) {
+            park();
+        }
+        markBusy();
+    }
 
-    if (m_queue.empty()) {
+    takeBatch();
+    const size_t batchSize = m_batch.size();
+    if (!batchSize) {
+        markIdle();
         return;
     }
 
-    auto fn = m_queue.front();
-    m_queue.pop();
+    m_batchLoad.store(batchSize, std::memory_order_relaxed);
+    if (m_queueCapacity) {
+        m_spaceEventCount.notify(batchSize);
+    }
 
-    lock.unlock();
+    size_t batchLoad = batchSize;
+    for (auto &fn : m_batch) {
+        if (m_interruptImmediately) {
+            break;
+        }
+        // slot is emptied before call, so crash leaves only not executed tasks in batch
+        auto task = std::move(fn);
+        task();
+        m_batchLoad.store(--batchLoad, std::memory_order_relaxed);
+    }
+    m_batchLoad.store(0u, std::memory_order_relaxed);
+    // not executed part of batch is kept for interruptImmediately()
+    std::erase_if(m_batch, [](const auto &fn) { return !fn; });
+}
+
+void ThreadPoolQueued::SimpleThread::takeBatch()
+{
+    // single consumer, so whole backlog up to the limit may be taken at once.
+    // Counter may be positive while the task is not linked yet, then nothing is taken and trigger() comes back.
+    if (m_isLockFree) {
+        Func fn;
+        size_t taken = 0u;
+        while (taken < m_maxBatchSize && m_lockFreeQueue.tryPop(fn)) {
+            m_batch.emplace_back(std::move(fn));
+            ++taken;
+        }
+        if (taken) {
+            m_queueSize.fetch_sub(taken, std::memory_order_seq_cst);
+        }
+        return;
+    }
 
-    fn();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const size_t batchSize = std::min(m_queue.size(), m_maxBatchSize);
+    for (size_t i = 0; i < batchSize; ++i) {
+        m_batch.emplace_back(std::move(m_queue.front()));
+        m_queue.pop();
+    }
+    m_queueSize.store(m_queue.size(), std::memory_order_relaxed);
 }
 
-ThreadPoolQueued::ThreadPoolQueued(uint8_t numberOfThreads)
+ThreadPoolQueued::ThreadPoolQueued(size_t numberOfThreads)
+    : ThreadPoolQueued(numberOfThreads, Options())
+{
+}
+
+ThreadPoolQueued::ThreadPoolQueued(size_t numberOfThreads, const Options &options)
     : m_threadIndex(0)
+    , m_options(options)
     , m_maxNumberOfThreads(numberOfThreads)
 {
 }
@@ -145,8 +481,8 @@ void ThreadPoolQueued::run()
 {
     m_threads.resize(m_maxNumberOfThreads);
 
-    for (uint8_t i = 0; i < m_maxNumberOfThreads; ++i) {
-        auto simpleThread = std::make_shared<SimpleThread>();
+    for (size_t i = 0; i < m_maxNumberOfThreads; ++i) {
+        auto simpleThread = std::make_shared<SimpleThread>(*this, m_options, i);
         m_onCrashSubs[i] = simpleThread->onCrashEvent().subscribe([this, i](const auto &error, const auto &stacktrace) {
             LOG_ERROR("Crash in pool queued thread: " << std::this_thread::get_id());
             LOG_ERROR(error);
@@ -159,11 +495,11 @@ void ThreadPoolQueued::run()
                 return;
             }
 
-            auto &q = m_threads[i]->m_queue;
-            LOG_INFO("Redirecting remaining queue size: " << q.size());
-            while (!q.empty()) {
-                auto fn = q.front();
-                q.pop();
+            // crashed thread itself is the only consumer of its queue
+            std::vector<Func> tasks;
+            m_threads[i]->takeTasks(tasks);
+            LOG_INFO("Redirecting remaining queue size: " << tasks.size());
+            for (auto &fn : tasks) {
                 invoke(std::move(fn));
             }
         });
@@ -191,6 +527,58 @@ void ThreadPoolQueued::interruptImmediately()
     }
 }
 
+void ThreadPoolQueued::interruptImmediately(std::vector<Func> &unexecutedTasks)
+{
+    interruptImmediately();
+    for (auto &t : m_threads) {
+        t->takeTasks(unexecutedTasks);
+    }
+}
+
+size_t ThreadPoolQueued::drain()
+{
+    for (auto &t : m_threads) {
+        t->stopIntake();
+    }
+    const size_t result = getWorkload();
+    interrupt();
+    return result;
+}
+
+bool ThreadPoolQueued::waitForIdle(std::chrono::nanoseconds timeout)
+{
+    // registration as waiter goes before the check, see SimpleThread::markIdle()
+    std::unique_lock<std::mutex> lock(m_idleMutex);
+    ++m_idleWaiters;
+    bool result = true;
+    if (timeout == std::chrono::nanoseconds::max()) {
+        m_idleCondition.wait(lock, [this]() { return isIdle(); });
+    } else {
+        result = m_idleCondition.wait_for(lock, timeout, [this]() { return isIdle(); });
+    }
+    --m_idleWaiters;
+    return result;
+}
+
+bool ThreadPoolQueued::isIdle()
+{
+    for (auto &t : m_threads) {
+        if (!t->isIdle()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ThreadPoolQueued::notifyIdle()
+{
+    // seq_cst store of busy flag and this load pair with registration of waiter
+    if (m_idleWaiters > 0u) {
+        std::lock_guard<std::mutex> lock(m_idleMutex);
+        m_idleCondition.notify_all();
+    }
+}
+
 bool ThreadPoolQueued::isRunning()
 {
     for (auto &t : m_threads) {
@@ -202,10 +590,39 @@ bool ThreadPoolQueued::isRunning()
     return false;
 }
 
+size_t ThreadPoolQueued::selectThread()
+{
+    const size_t threadsCount = m_threads.size();
+    switch (m_options.dispatchPolicy) {
+    case DispatchPolicy::ROUND_ROBIN:
+        break;
+    case DispatchPolicy::POWER_OF_TWO_CHOICES:
+        if (threadsCount > 1u) {
+            const size_t first = nextRandom() % threadsCount;
+            size_t second = nextRandom() % (threadsCount - 1u);
+            second += second >= first ? 1u : 0u;
+            return m_threads[second]->getLoad() < m_threads[first]->getLoad() ? second : first;
+        }
+        break;
+    case DispatchPolicy::LEAST_LOADED: {
+        size_t result = 0u;
+        size_t leastLoad = std::numeric_limits<size_t>::max();
+        for (size_t i = 0; i < threadsCount && leastLoad; ++i) {
+            const size_t load = m_threads[i]->getLoad();
+            if (load < leastLoad) {
+                leastLoad = load;
+                result = i;
+            }
+        }
+        return result;
+    }
+    }
+    return m_threadIndex++ % threadsCount;
+}
+
 void ThreadPoolQueued::invoke(Func &&fn)
 {
-    const uint8_t index = m_threadIndex++ % m_threads.size();
-    auto &t = m_threads[index];
+    auto &t = m_threads[selectThread()];
     if (t->isRunning()) {
         t->invoke(std::move(fn));
     } else if (isRunning()) {
@@ -213,6 +630,70 @@ void ThreadPoolQueued::invoke(Func &&fn)
     }
 }
 
+void ThreadPoolQueued::invoke(size_t key, Func &&fn)
+{
+    // thread of key is crashed: key is rehashed until it hits an alive thread, keys of alive threads stay in place
+    const size_t threadsCount = m_threads.size();
+    for (size_t attempt = 0; attempt < threadsCount; ++attempt) {
+        auto &t = m_threads[jumpConsistentHash(key, threadsCount)];
+        if (t->isRunning()) {
+            t->invoke(std::move(fn));
+            return;
+        }
+        key = mixKey(key);
+    }
+
+    // unlucky probes, still the same thread for the same key
+    for (auto &t : m_threads) {
+        if (t->isRunning()) {
+            t->invoke(std::move(fn));
+            return;
+        }
+    }
+}
+
+bool ThreadPoolQueued::tryInvoke(Func &&fn)
+{
+    if (m_threads.empty()) {
+        return false;
+    }
+
+    return m_threads[selectThread()]->tryInvoke(std::forward<Func>(fn));
+}
+
+size_t ThreadPoolQueued::getRejectedTasks() const
+{
+    size_t result = 0u;
+
+    for (auto &t : m_threads) {
+        result += t->getRejectedTasks();
+    }
+
+    return result;
+}
+
+void ThreadPoolQueued::invokeBatch(std::span<Func> tasks)
+{
+    if (m_threads.empty() || tasks.empty()) {
+        return;
+    }
+
+    // contiguous chunks keep neighbour tasks on the same thread
+    const size_t threadsCount = m_threads.size();
+    const size_t chunkSize = (tasks.size() + threadsCount - 1) / threadsCount;
+    for (size_t offset = 0; offset < tasks.size(); offset += chunkSize) {
+        auto chunk = tasks.subspan(offset, std::min(chunkSize, tasks.size() - offset));
+        auto &t = m_threads[selectThread()];
+        if (t->isRunning()) {
+            t->invokeBatch(chunk);
+        } else if (isRunning()) {
+            for (auto &fn : chunk) {
+                invoke(std::move(fn));
+            }
+        }
+    }
+}
+
 size_t ThreadPoolQueued::getWorkload() const
 {
     size_t result = 0u;
@@ -0,0 +1,308 @@
+#include "psi/thread/ThreadPoolStealing.h"
+
+#include "psi/thread/CrashHandler.h"
+
+#ifdef PSI_LOGGER
+#include "psi/logger/Logger.h"
+#else
+#include <iostream>
+#include <sstream>
+#define LOG_INFO(x)                                                                                                    \
+    do {                                                                                                               \
+        std::ostringstream os;                                                                                         \
+        os << x;                                                                                                       \
+        std::cout << os.str() << std::endl;                                                                            \
+    } while (0)
+#define LOG_ERROR(x) LOG_INFO(x)
+#endif
+
+namespace psi::thread {
+
+namespace {
+thread_local const ThreadPoolStealing *t_pool = nullptr;
+thread_local size_t t_workerIndex = 0u;
+} // namespace
+
+ThreadPoolStealing::ThreadPoolStealing(size_t numberOfThreads)
+    : m_isActive(false)
+    , m_interruptImmediately(false)
+    , m_maxNumberOfThreads(numberOfThreads)
+{
+}
+
+ThreadPoolStealing::~ThreadPoolStealing()
+{
+    interrupt();
+}
+
+void ThreadPoolStealing::run()
+{
+    if (m_isActive) {
+        return;
+    }
+
+    m_workers.clear();
+    for (size_t i = 0; i < m_maxNumberOfThreads; ++i) {
+        auto worker = std::make_unique<Worker>();
+        worker->random.seed(i + 1);
+        m_workers.emplace_back(std::move(worker));
+    }
+
+    m_isActive = true;
+
+    for (size_t i = 0; i < m_maxNumberOfThreads; ++i) {
+        m_threads.emplace_back(std::thread(std::bind(&ThreadPoolStealing::onThreadUpdate, this, i)));
+    }
+
+    while (m_aliveThreads < m_maxNumberOfThreads) {
+        std::this_thread::sleep_for(std::chrono::microseconds(1));
+    }
+}
+
+void ThreadPoolStealing::join()
+{
+    for (auto &thread : m_threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+void ThreadPoolStealing::interrupt()
+{
+    if (m_isActive) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isActive = false;
+        }
+        m_condition.notify_all();
+    }
+
+    join();
+
+    m_threads.clear();
+    clearQueues();
+}
+
+void ThreadPoolStealing::interruptImmediately()
+{
+    m_interruptImmediately = true;
+    interrupt();
+}
+
+void ThreadPoolStealing::onThreadUpdate(size_t index)
+{
+    const auto threadId = std::this_thread::get_id();
+    LOG_INFO("Start stealing pool thread: " << threadId);
+
+    auto runThread = [this, index]() {
+        t_pool = this;
+        t_workerIndex = index;
+        ++m_aliveThreads;
+
+        while (m_isActive) {
+            trigger(index);
+        }
+
+        while (!m_interruptImmediately && m_pendingTasks) {
+            trigger(index);
+        }
+
+        t_pool = nullptr;
+    };
+
+    CrashHandler ch;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_onCrashSubs[threadId] = ch.crashEvent().subscribe([this](const auto &error, const auto &stacktrace) {
+            LOG_ERROR("Crash in stealing pool thread: " << std::this_thread::get_id() << ", error: [" << error << "]");
+            LOG_ERROR(stacktrace);
+        });
+    }
+
+    ch.invoke(runThread);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_onCrashSubs.erase(m_onCrashSubs.find(threadId));
+    }
+
+    --m_aliveThreads;
+
+    LOG_INFO("Exit stealing pool thread: " << threadId);
+}
+
+size_t ThreadPoolStealing::getWorkload() const
+{
+    return m_pendingTasks;
+}
+
+void ThreadPoolStealing::invoke(Func &&fn)
+{
+    if (!isRunning()) {
+        return;
+    }
+
+    ++m_pendingTasks;
+
+    if (t_pool == this) {
+        // spawned by own worker: no lock, stays hot in this worker's cache unless stolen
+        m_workers[t_workerIndex]->deque.push(new Func(std::forward<Func>(fn)));
+    } else {
+        auto &worker = *m_workers[m_nextInbox++ % m_workers.size()];
+        std::lock_guard<std::mutex> lock(worker.inboxMutex);
+        worker.inbox.emplace(std::forward<Func>(fn));
+    }
+
+    notifySleeper();
+}
+
+void ThreadPoolStealing::invokeBatch(std::span<Func> tasks)
+{
+    if (!isRunning() || tasks.empty()) {
+        return;
+    }
+
+    m_pendingTasks += tasks.size();
+
+    if (t_pool == this) {
+        auto &deque = m_workers[t_workerIndex]->deque;
+        for (auto &fn : tasks) {
+            deque.push(new Func(std::move(fn)));
+        }
+    } else {
+        // contiguous chunks over inboxes, idle workers steal the rest
+        const size_t workersCount = m_workers.size();
+        const size_t chunkSize = (tasks.size() + workersCount - 1) / workersCount;
+        for (size_t offset = 0; offset < tasks.size(); offset += chunkSize) {
+            auto &worker = *m_workers[m_nextInbox++ % workersCount];
+            const size_t end = std::min(offset + chunkSize, tasks.size());
+            std::lock_guard<std::mutex> lock(worker.inboxMutex);
+            for (size_t i = offset; i < end; ++i) {
+                worker.inbox.emplace(std::move(tasks[i]));
+            }
+        }
+    }
+
+    notifySleepers(tasks.size());
+}
+
+bool ThreadPoolStealing::isRunning()
+{
+    return m_isActive;
+}
+
+void ThreadPoolStealing::notifySleeper()
+{
+    // pairs with increment of m_sleepingThreads under m_mutex in trigger()
+    if (m_sleepingThreads) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_condition.notify_one();
+    }
+}
+
+void ThreadPoolStealing::notifySleepers(size_t tasksCount)
+{
+    if (!m_sleepingThreads) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (tasksCount >= m_sleepingThreads) {
+        m_condition.notify_all();
+        return;
+    }
+
+    for (size_t i = 0; i < tasksCount; ++i) {
+        m_condition.notify_one();
+    }
+}
+
+bool ThreadPoolStealing::popTask(size_t index, Func &fn)
+{
+    auto &worker = *m_workers[index];
+
+    if (auto task = worker.deque.pop()) {
+        fn = std::move(**task);
+        delete *task;
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(worker.inboxMutex);
+        if (!worker.inbox.empty()) {
+            fn = std::move(worker.inbox.front());
+            worker.inbox.pop();
+            return true;
+        }
+    }
+
+    return stealTask(index, fn);
+}
+
+bool ThreadPoolStealing::stealTask(size_t index, Func &fn)
+{
+    const size_t workersCount = m_workers.size();
+    if (workersCount < 2) {
+        return false;
+    }
+
+    auto &thief = *m_workers[index];
+    const size_t start = thief.random() % workersCount;
+    for (size_t i = 0; i < workersCount; ++i) {
+        const size_t victimIndex = (start + i) % workersCount;
+        if (victimIndex == index) {
+            continue;
+        }
+
+        auto &victim = *m_workers[victimIndex];
+        if (auto task = victim.deque.steal()) {
+            fn = std::move(**task);
+            delete *task;
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lock(victim.inboxMutex, std::try_to_lock);
+        if (lock.owns_lock() && !victim.inbox.empty()) {
+            fn = std::move(victim.inbox.front());
+            victim.inbox.pop();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPoolStealing::trigger(size_t index)
+{
+    Func fn;
+    if (popTask(index, fn)) {
+        --m_pendingTasks;
+        fn();
+        return;
+    }
+
+    if (!m_isActive) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    ++m_sleepingThreads;
+    m_condition.wait(lock, [this]() { return m_pendingTasks > 0 || !m_isActive; });
+    --m_sleepingThreads;
+}
+
+void ThreadPoolStealing::clearQueues()
+{
+    for (auto &worker : m_workers) {
+        while (auto task = worker->deque.pop()) {
+            delete *task;
+            --m_pendingTasks;
+        }
+
+        std::lock_guard<std::mutex> lock(worker->inboxMutex);
+        m_pendingTasks -= worker->inbox.size();
+        worker->inbox.clear();
+    }
+}
+
+} // namespace psi::thread
@@ -211,7 +211,7 @@ void TimerLoop::trigger()
 
     auto itr = m_queue.begin();
     LOG_INFO("[" << itr->first.time_since_epoch().count() << "] timers.size():" << itr->second.size());
-    auto timers = itr->second;
+    auto timers = std::move(itr->second);
     m_queue.erase(itr);
     if (!m_queue.empty()) {
         itr = m_queue.begin();
@@ -0,0 +1,233 @@
+#include "psi/thread/Topology.h"
+
+#ifdef __linux__
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+namespace psi::thread {
+
+namespace {
+
+std::string readLine(const std::filesystem::path &path)
+{
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+bool parseNumber(const std::string &str, long long &result)
+{
+    std::istringstream stream(str);
+    stream >> result;
+    return !stream.fail();
+}
+
+CpuSet allCpus()
+{
+    CpuSet result(std::max(1u, std::thread::hardware_concurrency()));
+    std::iota(result.begin(), result.end(), 0u);
+    return result;
+}
+
+#ifdef __linux__
+size_t cgroupCpuLimit()
+{
+    size_t limit = 0u;
+    auto applyLimit = [&limit](size_t groupLimit) {
+        if (groupLimit && (!limit || groupLimit < limit)) {
+            limit = groupLimit;
+        }
+    };
+
+    // cgroup v2: own group is "0::<path>", ancestors may be limited as well
+    std::ifstream cgroups("/proc/self/cgroup");
+    std::string line;
+    while (std::getline(cgroups, line)) {
+        if (line.rfind("0::", 0) != 0) {
+            continue;
+        }
+
+        std::filesystem::path group = line.substr(3);
+        while (true) {
+            applyLimit(Topology::parseCpuMax(readLine("/sys/fs/cgroup" + group.string() + "/cpu.max")));
+            if (group == group.parent_path()) {
+                break;
+            }
+            group = group.parent_path();
+        }
+    }
+
+    // cgroup v1
+    for (const std::string dir : {"/sys/fs/cgroup/cpu", "/sys/fs/cgroup/cpu,cpuacct"}) {
+        const auto quota = readLine(dir + "/cpu.cfs_quota_us");
+        const auto period = readLine(dir + "/cpu.cfs_period_us");
+        if (!quota.empty() && !period.empty()) {
+            applyLimit(Topology::parseCpuMax(quota + " " + period));
+        }
+    }
+
+    return limit;
+}
+#endif
+
+} // namespace
+
+CpuSet Topology::availableCpus()
+{
+    CpuSet result;
+
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                result.push_back(cpu);
+            }
+        }
+    }
+#endif
+
+    return result.empty() ? allCpus() : result;
+}
+
+std::vector<NumaNode> Topology::numaNodes()
+{
+    std::vector<NumaNode> nodes;
+    const auto available = availableCpus();
+
+#ifdef __linux__
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+        const auto name = entry.path().filename().string();
+        if (name.size() <= 4u || name.rfind("node", 0) != 0
+            || !std::all_of(name.begin() + 4, name.end(), [](unsigned char c) { return std::isdigit(c); })) {
+            continue;
+        }
+
+        NumaNode node;
+        node.id = std::stoul(name.substr(4));
+        for (size_t cpu : parseCpuList(readLine(entry.path() / "cpulist"))) {
+            if (std::binary_search(available.begin(), available.end(), cpu)) {
+                node.cpus.push_back(cpu);
+            }
+        }
+        if (!node.cpus.empty()) {
+            nodes.emplace_back(std::move(node));
+        }
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const auto &lhs, const auto &rhs) { return lhs.id < rhs.id; });
+#endif
+
+    if (nodes.empty()) {
+        nodes.emplace_back(NumaNode {0u, available});
+    }
+    return nodes;
+}
+
+size_t Topology::defaultNumberOfThreads()
+{
+    size_t result = availableCpus().size();
+
+#ifdef __linux__
+    if (const size_t limit = cgroupCpuLimit()) {
+        result = std::min(result, limit);
+    }
+#endif
+
+    return std::max<size_t>(result, 1u);
+}
+
+bool Topology::pinCurrentThread(const CpuSet &cpus)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    bool isEmpty = true;
+    for (size_t cpu : cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+            isEmpty = false;
+        }
+    }
+    return !isEmpty && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+std::optional<size_t> Topology::currentNode(const std::vector<NumaNode> &nodes)
+{
+#ifdef __linux__
+    const int cpu = sched_getcpu();
+    if (cpu < 0) {
+        return std::nullopt;
+    }
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (std::binary_search(nodes[i].cpus.begin(), nodes[i].cpus.end(), static_cast<size_t>(cpu))) {
+            return i;
+        }
+    }
+#else
+    (void)nodes;
+#endif
+    return std::nullopt;
+}
+
+CpuSet Topology::parseCpuList(const std::string &str)
+{
+    CpuSet result;
+
+    std::istringstream stream(str);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        const size_t dash = range.find('-');
+        long long first = 0;
+        long long last = 0;
+        if (!parseNumber(range.substr(0, dash), first)) {
+            continue;
+        }
+        if (dash == std::string::npos) {
+            last = first;
+        } else if (!parseNumber(range.substr(dash + 1), last)) {
+            continue;
+        }
+
+        for (long long cpu = std::max(first, 0ll); cpu <= last; ++cpu) {
+            result.push_back(static_cast<size_t>(cpu));
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+size_t Topology::parseCpuMax(const std::string &str)
+{
+    std::istringstream stream(str);
+    std::string quotaStr;
+    long long period = 0;
+    stream >> quotaStr >> period;
+
+    long long quota = 0;
+    if (quotaStr == "max" || !parseNumber(quotaStr, quota) || quota <= 0 || period <= 0) {
+        return 0u;
+    }
+
+    return static_cast<size_t>((quota + period - 1) / period);
+}
+
+} // namespace psi::thread
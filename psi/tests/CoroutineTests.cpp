@@ -0,0 +1,167 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "psi/thread/Coroutine.h"
+#include "psi/thread/PostponeLoop.h"
+#include "psi/thread/ThreadPool.h"
+#include "psi/thread/ThreadPoolQueued.h"
+
+using namespace ::testing;
+using namespace psi::thread;
+
+namespace {
+
+Task<int> one()
+{
+    co_return 1;
+}
+
+Task<int> addOnLoop(ILoop &loop, int a, int b)
+{
+    co_await schedule(loop);
+    co_return a + b;
+}
+
+Task<void> fail()
+{
+    throw std::runtime_error("failed");
+    co_return;
+}
+
+} // namespace
+
+TEST(CoroutineTests, ScheduleContinuesOnPoolThread)
+{
+    ThreadPoolQueued pool(2);
+    pool.run();
+
+    auto task = [](ThreadPoolQueued &pool) -> Task<std::thread::id> {
+        co_await pool.schedule();
+        co_return std::this_thread::get_id();
+    };
+    EXPECT_NE(std::this_thread::get_id(), spawn(pool, task(pool)).get());
+
+    auto sum = [](ThreadPool &pool) -> Task<int> {
+        int result = 0;
+        for (int i = 0; i < 100; ++i) {
+            result += co_await addOnLoop(pool, i, 1);
+        }
+        co_return result;
+    };
+    ThreadPool other(2);
+    other.run();
+    EXPECT_EQ(5'050, spawn(pool, sum(other)).get());
+
+    other.interrupt();
+    pool.interrupt();
+}
+
+TEST(CoroutineTests, TaskIsLazy)
+{
+    bool isStarted = false;
+    auto task = [](bool &isStarted) -> Task<void> {
+        isStarted = true;
+        co_return;
+    }(isStarted);
+    EXPECT_TRUE(task.valid());
+    EXPECT_FALSE(isStarted);
+}
+
+TEST(CoroutineTests, SymmetricTransferDoesNotGrowStack)
+{
+    ThreadPool pool(1);
+    pool.run();
+
+#ifdef NDEBUG
+    const int N_AWAITS = 1'000'000;
+#else
+    // without optimizations compiler does not turn symmetric transfer into tail call
+    const int N_AWAITS = 1'000;
+#endif
+
+    // every one() completes synchronously, resuming awaiting coroutine recursively would overflow stack
+    auto task = [N_AWAITS]() -> Task<int> {
+        int result = 0;
+        for (int i = 0; i < N_AWAITS; ++i) {
+            result += co_await one();
+        }
+        co_return result;
+    };
+    EXPECT_EQ(N_AWAITS, spawn(pool, task()).get());
+
+    pool.interrupt();
+}
+
+TEST(CoroutineTests, ExceptionIsRethrownByAwaiter)
+{
+    ThreadPool pool(1);
+    pool.run();
+
+    auto task = []() -> Task<int> {
+        try {
+            co_await fail();
+        } catch (const std::runtime_error &) {
+            co_return 1;
+        }
+        co_return 0;
+    };
+    EXPECT_EQ(1, spawn(pool, task()).get());
+    EXPECT_THROW(spawn(pool, fail()).get(), std::runtime_error);
+
+    pool.interrupt();
+}
+
+TEST(CoroutineTests, SleepDoesNotBlockPoolThread)
+{
+    const size_t N_COROUTINES = 100;
+    const auto SLEEP_TIME = std::chrono::milliseconds(50);
+
+    ThreadPool pool(1);
+    pool.run();
+    PostponeLoop timers;
+
+    auto task = [&]() -> Task<std::thread::id> {
+        co_await timers.sleepFor(SLEEP_TIME, pool);
+        co_return std::this_thread::get_id();
+    };
+
+    const auto startTs = std::chrono::high_resolution_clock::now();
+    std::vector<Future<std::thread::id>> futures;
+    for (size_t i = 0; i < N_COROUTINES; ++i) {
+        futures.emplace_back(spawn(pool, task()));
+    }
+    const auto poolThread = pool.submit([]() { return std::this_thread::get_id(); }).get();
+    for (auto &future : futures) {
+        EXPECT_EQ(poolThread, future.get());
+    }
+    const auto elapsed = std::chrono::high_resolution_clock::now() - startTs;
+
+    // single pool thread served all sleeping coroutines at once
+    EXPECT_GE(elapsed, SLEEP_TIME);
+    EXPECT_LT(elapsed, SLEEP_TIME * N_COROUTINES / 4);
+
+    timers.interrupt();
+    pool.interrupt();
+}
+
+TEST(CoroutineTests, DroppedCoroutineIsResumedWithError)
+{
+    ThreadPool running(1);
+    running.run();
+    ThreadPool stopped(1);
+
+    auto task = [](ILoop &loop) -> Task<int> {
+        co_await schedule(loop);
+        co_return 1;
+    };
+    EXPECT_THROW(spawn(running, task(stopped)).get(), std::future_error);
+    EXPECT_THROW(spawn(stopped, task(running)).get(), std::future_error);
+
+    running.interrupt();
+}
@@ -0,0 +1,93 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "psi/thread/DaryHeap.h"
+
+using namespace ::testing;
+using namespace psi::thread;
+
+TEST(DaryHeapTests, PopsElementsInOrder)
+{
+    std::mt19937 random(42);
+    std::vector<int> values(1000);
+    for (auto &value : values) {
+        value = static_cast<int>(random() % 100);
+    }
+
+    DaryHeap<int> heap;
+    std::vector<int> result;
+    // interleaved pushes and pops
+    for (size_t i = 0; i < values.size(); ++i) {
+        heap.push(int(values[i]));
+        if (i % 3 == 2) {
+            result.push_back(heap.top());
+            heap.pop();
+        }
+    }
+    std::vector<int> rest;
+    while (!heap.empty()) {
+        rest.push_back(heap.top());
+        heap.pop();
+    }
+
+    EXPECT_TRUE(std::is_sorted(rest.begin(), rest.end()));
+    result.insert(result.end(), rest.begin(), rest.end());
+    std::sort(result.begin(), result.end());
+    std::sort(values.begin(), values.end());
+    EXPECT_EQ(values, result);
+}
+
+TEST(DaryHeapTests, SupportsMoveOnlyElementsAndCustomOrder)
+{
+    struct Greater {
+        bool operator()(const std::unique_ptr<int> &lhs, const std::unique_ptr<int> &rhs) const
+        {
+            return *lhs > *rhs;
+        }
+    };
+
+    DaryHeap<std::unique_ptr<int>, Greater, 3u> heap;
+    for (int value : {3, 1, 4, 1, 5, 9, 2, 6}) {
+        heap.emplace(std::make_unique<int>(value));
+    }
+
+    std::vector<int> result;
+    while (!heap.empty()) {
+        result.push_back(*heap.top());
+        heap.pop();
+    }
+
+    const std::vector<int> expected = {9, 6, 5, 4, 3, 2, 1, 1};
+    EXPECT_EQ(expected, result);
+}
+
+TEST(DaryHeapTests, EraseKeepsHeapOrder)
+{
+    std::mt19937 random(7);
+    DaryHeap<int> heap;
+    std::vector<int> values;
+    for (int i = 0; i < 500; ++i) {
+        values.push_back(static_cast<int>(random() % 1000));
+        heap.push(int(values.back()));
+    }
+
+    // erase from random positions, including the last one
+    for (int i = 0; i < 200; ++i) {
+        const size_t index = i % 10 ? random() % heap.size() : heap.size() - 1u;
+        values.erase(std::find(values.begin(), values.end(), heap[index]));
+        heap.erase(index);
+    }
+
+    std::vector<int> result;
+    while (!heap.empty()) {
+        result.push_back(heap.top());
+        heap.pop();
+    }
+    std::sort(values.begin(), values.end());
+    EXPECT_EQ(values, result);
+}
@@ -0,0 +1,92 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "psi/thread/EventCount.h"
+
+using namespace ::testing;
+using namespace psi::thread;
+
+TEST(EventCountTests, CancelledWaitDoesNotBlock)
+{
+    EventCount eventCount;
+
+    const auto key = eventCount.prepareWait();
+    EXPECT_EQ(1u, eventCount.waiters());
+    eventCount.cancelWait();
+    EXPECT_EQ(0u, eventCount.waiters());
+
+    // epoch is still the same, nobody was waiting so nothing was notified
+    eventCount.notifyOne();
+    EXPECT_EQ(key, eventCount.prepareWait());
+    eventCount.cancelWait();
+}
+
+TEST(EventCountTests, NotifyAfterPrepareReleasesCommit)
+{
+    EventCount eventCount;
+
+    const auto key = eventCount.prepareWait();
+    eventCount.notifyOne();
+
+    // returns at once, because epoch changed after prepareWait
+    eventCount.commitWait(key);
+    EXPECT_EQ(0u, eventCount.waiters());
+}
+
+TEST(EventCountTests, NoLostWakeups)
+{
+    const size_t CONSUMERS = 4u;
+    const size_t ITEMS = 20000u;
+
+    EventCount eventCount;
+    std::atomic<size_t> available = 0u;
+    std::atomic<size_t> consumed = 0u;
+    std::atomic<bool> done = false;
+
+    std::vector<std::thread> consumers;
+    for (size_t i = 0; i < CONSUMERS; ++i) {
+        consumers.emplace_back([&]() {
+            while (true) {
+                size_t value = available.load();
+                while (value && !available.compare_exchange_weak(value, value - 1)) {
+                }
+                if (value) {
+                    ++consumed;
+                    continue;
+                }
+
+                const auto key = eventCount.prepareWait();
+                if (available.load() || done) {
+                    eventCount.cancelWait();
+                    if (done && !available.load()) {
+                        return;
+                    }
+                    continue;
+                }
+                eventCount.commitWait(key);
+            }
+        });
+    }
+
+    for (size_t i = 0; i < ITEMS; ++i) {
+        ++available;
+        eventCount.notifyOne();
+    }
+
+    while (consumed < ITEMS) {
+        std::this_thread::yield();
+    }
+
+    done = true;
+    eventCount.notifyAll();
+    for (auto &consumer : consumers) {
+        consumer.join();
+    }
+
+    EXPECT_EQ(ITEMS, consumed.load());
+    EXPECT_EQ(0u, eventCount.waiters());
+}
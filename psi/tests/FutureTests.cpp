@@ -0,0 +1,135 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "psi/thread/ThreadPool.h"
+#include "psi/thread/ThreadPoolQueued.h"
+
+using namespace ::testing;
+using namespace psi::thread;
+
+TEST(FutureTests, SubmitReturnsResult)
+{
+    ThreadPool pool(2);
+    pool.run();
+
+    auto future = pool.submit([]() { return 42; });
+    EXPECT_TRUE(future.valid());
+    EXPECT_EQ(42, future.get());
+    EXPECT_FALSE(future.valid());
+
+    auto moveOnly = pool.submit([]() { return std::make_unique<std::string>("value"); });
+    EXPECT_EQ("value", *moveOnly.get());
+
+    pool.interrupt();
+}
+
+TEST(FutureTests, SubmitVoidTask)
+{
+    ThreadPoolQueued pool(2);
+    pool.run();
+
+    std::atomic<bool> isCalled = false;
+    auto future = pool.submit([&isCalled]() { isCalled = true; });
+    future.get();
+    EXPECT_TRUE(isCalled);
+
+    pool.interrupt();
+}
+
+TEST(FutureTests, ExceptionIsPropagated)
+{
+    ThreadPool pool(1);
+    pool.run();
+
+    auto future = pool.submit([]() -> int { throw std::runtime_error("failed"); });
+    EXPECT_THROW(future.get(), std::runtime_error);
+
+    // pool thread survives
+    EXPECT_EQ(1, pool.submit([]() { return 1; }).get());
+
+    pool.interrupt();
+}
+
+TEST(FutureTests, ContinuationRunsOnExecutor)
+{
+    ThreadPool pool(2);
+    ThreadPoolQueued executor(1);
+    pool.run();
+    executor.run();
+
+    std::atomic<std::thread::id> executorThread;
+    executor.invoke([&executorThread]() { executorThread = std::this_thread::get_id(); });
+
+    auto future = pool.submit([]() { return 20; })
+                      .then([](int value) { return value + 1; }, executor)
+                      .then(
+                          [&executorThread](int value) {
+                              EXPECT_EQ(executorThread.load(), std::this_thread::get_id());
+                              return std::to_string(value * 2);
+                          },
+                          executor);
+    EXPECT_EQ("42", future.get());
+
+    pool.interrupt();
+    executor.interrupt();
+}
+
+TEST(FutureTests, ContinuationAttachedAfterResult)
+{
+    ThreadPool pool(1);
+    pool.run();
+
+    auto future = pool.submit([]() { return 1; });
+    future.wait();
+    EXPECT_TRUE(future.isReady());
+
+    EXPECT_EQ(2, future.then([](int value) { return value + 1; }, pool).get());
+
+    pool.interrupt();
+}
+
+TEST(FutureTests, ExceptionSkipsContinuation)
+{
+    ThreadPool pool(2);
+    pool.run();
+
+    std::atomic<bool> isCalled = false;
+    auto future = pool.submit([]() -> int { throw std::logic_error("failed"); })
+                      .then([&isCalled](int) { isCalled = true; }, pool)
+                      .then([&isCalled]() { isCalled = true; }, pool);
+    EXPECT_THROW(future.get(), std::logic_error);
+    EXPECT_FALSE(isCalled);
+
+    pool.interrupt();
+}
+
+TEST(FutureTests, DroppedTaskBreaksPromise)
+{
+    ThreadPool pool(1);
+
+    // pool is not running, task is dropped
+    auto future = pool.submit([]() { return 1; });
+    EXPECT_THROW(future.get(), std::future_error);
+}
+
+TEST(FutureTests, ContinuationDroppedByExecutorBreaksPromise)
+{
+    ThreadPool pool(1);
+    pool.run();
+    ThreadPool stopped(1);
+
+    auto captured = std::make_shared<int>();
+    auto future = pool.submit([]() { return 1; });
+    future.wait();
+    auto continued = future.then([captured](int value) { return value + 1; }, stopped);
+    EXPECT_THROW(continued.get(), std::future_error);
+    EXPECT_EQ(1, captured.use_count());
+
+    pool.interrupt();
+}
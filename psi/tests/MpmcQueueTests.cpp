@@ -0,0 +1,84 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "psi/thread/MpmcQueue.h"
+
+using namespace ::testing;
+using namespace psi::thread;
+
+TEST(MpmcQueueTests, CapacityIsRoundedToPowerOfTwo)
+{
+    EXPECT_EQ(2u, MpmcQueue<int>(0).capacity());
+    EXPECT_EQ(8u, MpmcQueue<int>(5).capacity());
+    EXPECT_EQ(16u, MpmcQueue<int>(16).capacity());
+}
+
+TEST(MpmcQueueTests, KeepsFifoOrderAndRejectsWhenFull)
+{
+    MpmcQueue<int> queue(4);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.tryPush(i));
+    }
+    EXPECT_FALSE(queue.tryPush(4));
+    EXPECT_EQ(4u, queue.size());
+
+    int value = -1;
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.tryPop(value));
+        EXPECT_EQ(i, value);
+    }
+    EXPECT_FALSE(queue.tryPop(value));
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(MpmcQueueTests, DestroysRemainingElements)
+{
+    auto element = std::make_shared<int>(1);
+    {
+        MpmcQueue<std::shared_ptr<int>> queue(4);
+        queue.tryPush(element);
+        queue.tryPush(element);
+        EXPECT_EQ(3, element.use_count());
+    }
+    EXPECT_EQ(1, element.use_count());
+}
+
+TEST(MpmcQueueTests, MultipleProducersMultipleConsumers)
+{
+    const size_t N_THREADS = 4;
+    const size_t N_ITEMS = 50'000;
+    MpmcQueue<size_t> queue(64);
+    std::atomic<size_t> sum = 0;
+    std::atomic<size_t> consumed = 0;
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < N_THREADS; ++t) {
+        threads.emplace_back([&queue]() {
+            for (size_t i = 1; i <= N_ITEMS; ++i) {
+                while (!queue.tryPush(i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        threads.emplace_back([&]() {
+            size_t value = 0;
+            while (consumed < N_THREADS * N_ITEMS) {
+                if (queue.tryPop(value)) {
+                    sum += value;
+                    ++consumed;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(N_THREADS * N_ITEMS * (N_ITEMS + 1) / 2, sum);
+}
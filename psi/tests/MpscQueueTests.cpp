@@ -0,0 +1,105 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "psi/thread/MpscQueue.h"
+
+using namespace ::testing;
+using namespace psi::thread;
+
+TEST(MpscQueueTests, KeepsFifoOrder)
+{
+    MpscQueue<int> queue;
+    EXPECT_TRUE(queue.empty());
+    for (int i = 0; i < 100; ++i) {
+        queue.push(i);
+    }
+    EXPECT_FALSE(queue.empty());
+
+    int value = -1;
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(queue.tryPop(value));
+        EXPECT_EQ(i, value);
+    }
+    EXPECT_FALSE(queue.tryPop(value));
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(MpscQueueTests, DestroysRemainingElements)
+{
+    auto element = std::make_shared<int>(1);
+    {
+        MpscQueue<std::shared_ptr<int>> queue;
+        queue.push(element);
+        queue.push(element);
+        queue.push(element);
+
+        std::shared_ptr<int> value;
+        EXPECT_TRUE(queue.tryPop(value));
+        value.reset();
+        EXPECT_EQ(3, element.use_count());
+    }
+    EXPECT_EQ(1, element.use_count());
+}
+
+TEST(MpscQueueTests, MultipleProducersKeepTheirOrder)
+{
+    const size_t N_PRODUCERS = 4;
+    const size_t N_ITEMS = 50'000;
+    MpscQueue<size_t> queue;
+
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < N_PRODUCERS; ++p) {
+        producers.emplace_back([&queue, p]() {
+            for (size_t i = 1; i <= N_ITEMS; ++i) {
+                queue.push(p * N_ITEMS + i);
+            }
+        });
+    }
+
+    std::vector<size_t> last(N_PRODUCERS);
+    size_t consumed = 0;
+    size_t value = 0;
+    while (consumed < N_PRODUCERS * N_ITEMS) {
+        if (!queue.tryPop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        const size_t producer = (value - 1) / N_ITEMS;
+        const size_t item = value - producer * N_ITEMS;
+        ASSERT_EQ(last[producer] + 1, item);
+        last[producer] = item;
+        ++consumed;
+    }
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(MpscQueueTests, SingleProducerSingleConsumer)
+{
+    const size_t N_ITEMS = 100'000;
+    SpscQueue<size_t> queue;
+
+    std::thread producer([&queue]() {
+        for (size_t i = 0; i < N_ITEMS; ++i) {
+            queue.push(i);
+        }
+    });
+
+    size_t expected = 0;
+    size_t value = 0;
+    while (expected < N_ITEMS) {
+        if (queue.tryPop(value)) {
+            ASSERT_EQ(expected, value);
+            ++expected;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+}
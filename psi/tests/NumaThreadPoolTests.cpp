@@ -0,0 +1,48 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+
+#include "psi/thread/NumaThreadPool.h"
+
+using namespace ::testing;
+using namespace psi::thread;
+
+TEST(NumaThreadPoolTests, ExecutesTasksOnEveryShard)
+{
+    const size_t N_TASKS = 1'000;
+    std::atomic<size_t> counter = 0;
+
+    // two fake nodes sharing available CPUs
+    const auto cpus = Topology::availableCpus();
+    NumaThreadPool::Options options;
+    options.threadsPerNode = 2u;
+    NumaThreadPool pool({NumaNode {0u, cpus}, NumaNode {1u, cpus}}, options);
+    pool.run();
+    EXPECT_EQ(2u, pool.getNodes().size());
+
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        pool.invoke([&counter]() { ++counter; });
+        pool.invoke([&counter]() { ++counter; }, i % 2);
+    }
+    EXPECT_EQ(7, pool.submit([]() { return 7; }).get());
+
+    pool.interrupt();
+    EXPECT_EQ(2 * N_TASKS, counter);
+    EXPECT_EQ(0u, pool.getWorkload());
+}
+
+TEST(NumaThreadPoolTests, UsesMachineTopologyByDefault)
+{
+    NumaThreadPool pool;
+    pool.run();
+    EXPECT_EQ(Topology::numaNodes().size(), pool.getNodes().size());
+    EXPECT_EQ(1, pool.submit([]() { return 1; }).get());
+    pool.interrupt();
+}
+
+TEST(NumaThreadPoolTests, NoNodesThrows)
+{
+    EXPECT_THROW(NumaThreadPool({}, NumaThreadPool::Options()), std::invalid_argument);
+}
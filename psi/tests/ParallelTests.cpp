@@ -0,0 +1,155 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "psi/thread/Parallel.h"
+#include "psi/thread/ThreadPool.h"
+
+using namespace ::testing;
+using namespace psi::thread;
+
+struct ParallelTests : TestWithParam<std::tuple<Chunking, bool>> {
+    ParallelOptions options(size_t grainSize = 0u)
+    {
+        ParallelOptions result;
+        result.chunking = std::get<0>(GetParam());
+        result.callerParticipates = std::get<1>(GetParam());
+        result.concurrency = 4u;
+        result.grainSize = grainSize;
+        return result;
+    }
+
+    static std::vector<int> randomValues(size_t size)
+    {
+        std::vector<int> values(size);
+        std::mt19937 random(42);
+        std::uniform_int_distribution<int> distribution(-1000, 1000);
+        std::generate(values.begin(), values.end(), [&]() { return distribution(random); });
+        return values;
+    }
+};
+
+TEST_P(ParallelTests, ForVisitsEveryIndexOnce)
+{
+    const size_t N = 100'000;
+    std::vector<std::atomic<int>> visits(N);
+
+    ThreadPool pool(4);
+    pool.run();
+
+    parallel_for(pool, size_t(0), N, [&visits](size_t i) { ++visits[i]; }, options());
+    EXPECT_TRUE(std::all_of(visits.begin(), visits.end(), [](const auto &value) { return value == 1; }));
+
+    // empty range and grain bigger than range
+    parallel_for(pool, 5, 5, [](int) { FAIL(); }, options());
+    std::atomic<int> counter = 0;
+    parallel_for(pool, -5, 5, [&counter](int i) { counter += i; }, options(1000u));
+    EXPECT_EQ(-5, counter);
+
+    pool.interrupt();
+}
+
+TEST_P(ParallelTests, ReduceTransformScanSortMatchStl)
+{
+    const auto values = randomValues(50'000);
+
+    ThreadPool pool(4);
+    pool.run();
+
+    EXPECT_EQ(std::accumulate(values.begin(), values.end(), 10ll),
+              parallel_reduce(pool, values.begin(), values.end(), 10ll, std::plus<>(), options(128u)));
+
+    std::vector<long long> transformed(values.size());
+    std::vector<long long> expectedTransformed(values.size());
+    auto square = [](int value) { return static_cast<long long>(value) * value; };
+    std::transform(values.begin(), values.end(), expectedTransformed.begin(), square);
+    EXPECT_EQ(transformed.end(),
+              parallel_transform(pool, values.begin(), values.end(), transformed.begin(), square, options()));
+    EXPECT_EQ(expectedTransformed, transformed);
+
+    std::vector<int> scanned(values.size());
+    std::vector<int> expectedScanned(values.size());
+    std::inclusive_scan(values.begin(), values.end(), expectedScanned.begin());
+    parallel_inclusive_scan(pool, values.begin(), values.end(), scanned.begin(), std::plus<>(), options(1000u));
+    EXPECT_EQ(expectedScanned, scanned);
+
+    // in place
+    scanned = values;
+    parallel_inclusive_scan(pool, scanned.begin(), scanned.end(), scanned.begin(), std::plus<>(), options(1000u));
+    EXPECT_EQ(expectedScanned, scanned);
+
+    // sizes not divisible by number of blocks, e.g. 9 elements with grain 2 make 3 blocks of 3 instead of 4
+    for (size_t size = 2; size <= 40; ++size) {
+        std::vector<int> small(values.begin(), values.begin() + size);
+        std::vector<int> expectedSmall(size);
+        std::vector<int> scannedSmall(size);
+        std::inclusive_scan(small.begin(), small.end(), expectedSmall.begin());
+        EXPECT_EQ(scannedSmall.end(),
+                  parallel_inclusive_scan(
+                      pool, small.begin(), small.end(), scannedSmall.begin(), std::plus<>(), options(2u)));
+        EXPECT_EQ(expectedSmall, scannedSmall) << "size " << size;
+    }
+
+    auto sorted = values;
+    auto expectedSorted = values;
+    std::sort(expectedSorted.begin(), expectedSorted.end(), std::greater<>());
+    parallel_sort(pool, sorted.begin(), sorted.end(), std::greater<>(), options(1000u));
+    EXPECT_EQ(expectedSorted, sorted);
+
+    pool.interrupt();
+}
+
+TEST_P(ParallelTests, ExceptionIsRethrownToCaller)
+{
+    ThreadPool pool(4);
+    pool.run();
+
+    std::atomic<size_t> counter = 0;
+    EXPECT_THROW(parallel_for(
+                     pool,
+                     0,
+                     10'000,
+                     [&counter](int i) {
+                         ++counter;
+                         if (i == 5'000) {
+                             throw std::runtime_error("failed");
+                         }
+                     },
+                     options(16u)),
+                 std::runtime_error);
+    EXPECT_LE(counter, 10'000u);
+
+    pool.interrupt();
+}
+
+TEST_P(ParallelTests, CallerFinishesWorkIfLoopIsNotRunning)
+{
+    ThreadPool pool(2);
+
+    std::atomic<size_t> counter = 0;
+    parallel_for(pool, 0, 1'000, [&counter](int) { ++counter; }, options(10u));
+    EXPECT_EQ(1'000u, counter);
+}
+
+TEST(ParallelNestedTests, CallerParticipatesInsideLoopThread)
+{
+    ThreadPool pool(1);
+    pool.run();
+
+    // the only pool thread runs outer task, inner reduce must not wait for itself
+    std::vector<int> values(1'000, 1);
+    auto future = pool.submit([&pool, &values]() { return parallel_reduce(pool, values.begin(), values.end(), 0); });
+    EXPECT_EQ(1'000, future.get());
+
+    pool.interrupt();
+}
+
+INSTANTIATE_TEST_SUITE_P(ChunkingAndCaller,
+                         ParallelTests,
+                         Combine(Values(Chunking::STATIC, Chunking::DYNAMIC, Chunking::GUIDED), Bool()));
@@ -0,0 +1,113 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "psi/thread/Strand.h"
+#include "psi/thread/ThreadPool.h"
+
+using namespace ::testing;
+using namespace psi::thread;
+
+TEST(StrandTests, TasksOfStrandRunInOrderOneAtATime)
+{
+    const size_t N_STRANDS = 16;
+    const size_t N_TASKS = 2000;
+
+    ThreadPool pool(4);
+    pool.run();
+
+    struct Entity {
+        explicit Entity(ILoop &loop)
+            : strand(loop)
+        {
+        }
+
+        Strand strand;
+        std::atomic<bool> isRunning = false;
+        size_t last = 0;
+        std::atomic<size_t> violations = 0;
+    };
+    std::deque<Entity> entities;
+    for (size_t i = 0; i < N_STRANDS; ++i) {
+        entities.emplace_back(pool);
+    }
+
+    // several producers per strand, order is checked per producer
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < 2; ++p) {
+        producers.emplace_back([&, p]() {
+            for (size_t i = 1; i <= N_TASKS; ++i) {
+                for (auto &entity : entities) {
+                    entity.strand.invoke([&entity, p, i]() {
+                        if (entity.isRunning.exchange(true)) {
+                            ++entity.violations;
+                        }
+                        const size_t shift = p * 32;
+                        const size_t previous = (entity.last >> shift) & 0xffffffffu;
+                        if (previous + 1 != i) {
+                            ++entity.violations;
+                        }
+                        entity.last += size_t(1) << shift;
+                        entity.isRunning = false;
+                    });
+                }
+            }
+        });
+    }
+    for (auto &producer : producers) {
+        producer.join();
+    }
+
+    for (auto &entity : entities) {
+        while (entity.strand.size()) {
+            std::this_thread::yield();
+        }
+        EXPECT_EQ(0u, entity.violations);
+        EXPECT_EQ(N_TASKS, entity.last & 0xffffffffu);
+        EXPECT_EQ(N_TASKS, entity.last >> 32);
+    }
+
+    pool.interrupt();
+}
+
+TEST(StrandTests, HotStrandDoesNotBlockOthers)
+{
+    ThreadPool pool(2);
+    pool.run();
+
+    Strand hot(pool);
+    Strand other(pool);
+    std::atomic<bool> isReleased = false;
+    std::atomic<bool> isOtherDone = false;
+    hot.invoke([&]() {
+        while (!isReleased) {
+            std::this_thread::yield();
+        }
+    });
+    other.invoke([&]() { isOtherDone = true; });
+    while (!isOtherDone) {
+        std::this_thread::yield();
+    }
+    isReleased = true;
+
+    pool.interrupt();
+}
+
+TEST(StrandTests, DroppedTasksAreDestroyed)
+{
+    // pool which is not running drops drain task
+    ThreadPool pool(1);
+
+    auto counter = std::make_shared<int>();
+    Strand strand(pool);
+    for (size_t i = 0; i < 10; ++i) {
+        strand.invoke([counter]() { FAIL(); });
+    }
+    EXPECT_EQ(0u, strand.size());
+    EXPECT_EQ(1, counter.use_count());
+}
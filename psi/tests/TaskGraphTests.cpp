@@ -0,0 +1,139 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "psi/thread/TaskGraph.h"
+#include "psi/thread/ThreadPool.h"
+#include "psi/thread/ThreadPoolQueued.h"
+
+using namespace ::testing;
+using namespace psi::thread;
+
+TEST(TaskGraphTests, NodesRunAfterTheirPredecessors)
+{
+    const size_t N_LAYERS = 20;
+    const size_t N_WIDTH = 8;
+    const size_t N_RUNS = 50;
+
+    ThreadPool pool(4);
+    pool.run();
+
+    // layers of nodes, every node depends on all nodes of previous layer
+    std::vector<std::atomic<size_t>> finished(N_LAYERS);
+    std::atomic<size_t> violations = 0;
+    TaskGraph graph;
+    std::vector<TaskGraph::NodeId> previous;
+    for (size_t layer = 0; layer < N_LAYERS; ++layer) {
+        std::vector<TaskGraph::NodeId> current;
+        for (size_t i = 0; i < N_WIDTH; ++i) {
+            const auto node = graph.addNode([&, layer]() {
+                if (layer && finished[layer - 1] % N_WIDTH) {
+                    ++violations;
+                }
+                ++finished[layer];
+            });
+            for (auto predecessor : previous) {
+                graph.addEdge(predecessor, node);
+            }
+            current.emplace_back(node);
+        }
+        previous = std::move(current);
+    }
+    EXPECT_EQ(N_LAYERS * N_WIDTH, graph.size());
+
+    for (size_t run = 1; run <= N_RUNS; ++run) {
+        graph.run(pool);
+        for (size_t layer = 0; layer < N_LAYERS; ++layer) {
+            ASSERT_EQ(run * N_WIDTH, finished[layer]);
+        }
+    }
+    EXPECT_EQ(0u, violations);
+    EXPECT_FALSE(graph.isRunning());
+
+    pool.interrupt();
+}
+
+TEST(TaskGraphTests, SingleSuccessorStaysOnSameThread)
+{
+    const size_t N_NODES = 100;
+
+    ThreadPoolQueued pool(4);
+    pool.run();
+
+    std::vector<std::thread::id> threads(N_NODES);
+    TaskGraph graph;
+    for (size_t i = 0; i < N_NODES; ++i) {
+        graph.addNode([&threads, i]() { threads[i] = std::this_thread::get_id(); });
+        if (i) {
+            graph.addEdge(i - 1, i);
+        }
+    }
+    graph.run(pool);
+
+    for (size_t i = 1; i < N_NODES; ++i) {
+        EXPECT_EQ(threads[0], threads[i]);
+    }
+
+    pool.interrupt();
+}
+
+TEST(TaskGraphTests, ExceptionSkipsSuccessorsAndIsRethrown)
+{
+    ThreadPool pool(2);
+    pool.run();
+
+    std::atomic<size_t> counter = 0;
+    TaskGraph graph;
+    const auto a = graph.addNode([&counter]() { ++counter; });
+    const auto b = graph.addNode([]() { throw std::runtime_error("failed"); });
+    const auto c = graph.addNode([&counter]() { ++counter; });
+    graph.addEdge(a, b);
+    graph.addEdge(b, c);
+
+    EXPECT_THROW(graph.run(pool), std::runtime_error);
+    EXPECT_EQ(1u, counter);
+
+    // next run starts from scratch
+    EXPECT_THROW(graph.run(pool), std::runtime_error);
+    EXPECT_EQ(2u, counter);
+
+    pool.interrupt();
+}
+
+TEST(TaskGraphTests, InvalidGraphThrows)
+{
+    ThreadPool pool(1);
+    pool.run();
+
+    TaskGraph graph;
+    graph.run(pool);
+
+    const auto a = graph.addNode([]() {});
+    const auto b = graph.addNode([]() {});
+    EXPECT_THROW(graph.addEdge(a, a), std::invalid_argument);
+    EXPECT_THROW(graph.addEdge(a, 5u), std::invalid_argument);
+
+    graph.addEdge(a, b);
+    graph.addEdge(b, a);
+    EXPECT_THROW(graph.run(pool), std::invalid_argument);
+    EXPECT_FALSE(graph.isRunning());
+
+    pool.interrupt();
+}
+
+TEST(TaskGraphTests, DroppedNodeFailsExecution)
+{
+    // pool which is not running drops given tasks
+    ThreadPool pool(1);
+
+    TaskGraph graph;
+    graph.addNode([]() {});
+    graph.start(pool);
+    EXPECT_THROW(graph.wait(), std::future_error);
+    EXPECT_FALSE(graph.isRunning());
+}
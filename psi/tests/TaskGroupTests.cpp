@@ -0,0 +1,83 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+#include "psi/thread/TaskGroup.h"
+#include "psi/thread/ThreadPool.h"
+
+using namespace ::testing;
+using namespace psi::thread;
+
+namespace {
+size_t fibonacci(ThreadPool &pool, size_t n)
+{
+    if (n < 2) {
+        return n;
+    }
+
+    size_t left = 0;
+    size_t right = 0;
+    TaskGroup group(pool);
+    group.run([&]() { left = fibonacci(pool, n - 1); });
+    group.run([&]() { right = fibonacci(pool, n - 2); });
+    group.wait();
+    return left + right;
+}
+} // namespace
+
+TEST(TaskGroupTests, NestedGroupsDoNotExhaustPool)
+{
+    // every level of recursion waits inside a task, blocking waiters would deadlock pool of 2 threads at once
+    for (bool localQueues : {true, false}) {
+        ThreadPool::Options options;
+        options.localQueues = localQueues;
+        ThreadPool pool(2, options);
+        pool.run();
+
+        std::promise<size_t> result;
+        pool.invoke([&]() { result.set_value(fibonacci(pool, 18)); });
+        EXPECT_EQ(2584u, result.get_future().get());
+
+        pool.interrupt();
+    }
+}
+
+TEST(TaskGroupTests, WaitRethrowsFirstException)
+{
+    ThreadPool pool(2);
+    pool.run();
+
+    std::atomic<size_t> executed = 0;
+    TaskGroup group(pool);
+    for (size_t i = 0; i < 100; ++i) {
+        group.run([&, i]() {
+            ++executed;
+            if (i == 50) {
+                throw std::runtime_error("failed");
+            }
+        });
+    }
+    EXPECT_THROW(group.wait(), std::runtime_error);
+    EXPECT_EQ(100u, executed);
+
+    // error is reset, group may be reused
+    group.run([&]() { ++executed; });
+    EXPECT_NO_THROW(group.wait());
+    EXPECT_EQ(101u, executed);
+
+    pool.interrupt();
+}
+
+TEST(TaskGroupTests, DroppedTaskBreaksPromise)
+{
+    ThreadPool pool(1);
+
+    TaskGroup group(pool);
+    group.run([]() {});
+    pool.interruptImmediately();
+    EXPECT_THROW(group.wait(), std::future_error);
+}
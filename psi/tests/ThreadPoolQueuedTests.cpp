@@ -0,0 +1,369 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "psi/thread/ThreadPoolQueued.h"
+
+using namespace ::testing;
+using namespace psi::thread;
+
+struct ThreadPoolQueuedIdleTests : TestWithParam<std::tuple<IdlePolicy, ThreadPoolQueued::QueueBackend>> {
+};
+
+TEST_P(ThreadPoolQueuedIdleTests, ExecutesAllTasks)
+{
+    const size_t N_TASKS = 10'000;
+    std::atomic<size_t> counter = 0;
+
+    ThreadPoolQueued::Options options;
+    options.idlePolicy = std::get<0>(GetParam());
+    options.queueBackend = std::get<1>(GetParam());
+    ThreadPoolQueued pool(4, options);
+    pool.run();
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        pool.invoke([&counter]() { ++counter; });
+    }
+    pool.interrupt();
+
+    EXPECT_EQ(N_TASKS, counter);
+    EXPECT_EQ(0u, pool.getWorkload());
+}
+
+INSTANTIATE_TEST_SUITE_P(IdlePolicies,
+                         ThreadPoolQueuedIdleTests,
+                         Combine(Values(IdlePolicy::BLOCK, IdlePolicy::SPIN_THEN_PARK, IdlePolicy::BUSY_POLL),
+                                 Values(ThreadPoolQueued::QueueBackend::MUTEX,
+                                        ThreadPoolQueued::QueueBackend::LOCK_FREE)));
+
+TEST(ThreadPoolQueuedLockFreeTests, WorkloadNeverExceedsInvokedTasks)
+{
+    // consumer which takes task before its producer counted it would make counter wrap around
+    const size_t N_PRODUCERS = 4;
+    const size_t N_TASKS = 20'000;
+
+    ThreadPoolQueued::Options options;
+    options.queueBackend = ThreadPoolQueued::QueueBackend::LOCK_FREE;
+    options.idlePolicy = IdlePolicy::BUSY_POLL;
+    options.maxBatchSize = 64u;
+    ThreadPoolQueued pool(2, options);
+    pool.run();
+
+    std::atomic<size_t> finished = 0;
+    std::vector<std::thread> producers;
+    for (size_t i = 0; i < N_PRODUCERS; ++i) {
+        producers.emplace_back([&]() {
+            for (size_t j = 0; j < N_TASKS; ++j) {
+                pool.invoke([]() {});
+            }
+            ++finished;
+        });
+    }
+
+    size_t maxWorkload = 0u;
+    while (finished < N_PRODUCERS) {
+        maxWorkload = std::max(maxWorkload, pool.getWorkload());
+    }
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    pool.interrupt();
+
+    EXPECT_LE(maxWorkload, N_PRODUCERS * N_TASKS);
+    EXPECT_EQ(0u, pool.getWorkload());
+}
+
+TEST_P(ThreadPoolQueuedIdleTests, WaitForIdleReturnsWhenAllTasksAreDone)
+{
+    const size_t N_TASKS = 1'000;
+    std::atomic<size_t> counter = 0;
+
+    ThreadPoolQueued::Options options;
+    options.idlePolicy = std::get<0>(GetParam());
+    options.queueBackend = std::get<1>(GetParam());
+    ThreadPoolQueued pool(4, options);
+    pool.run();
+    EXPECT_TRUE(pool.waitForIdle());
+
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        pool.invoke([&counter]() { ++counter; });
+    }
+    EXPECT_TRUE(pool.waitForIdle());
+    EXPECT_EQ(N_TASKS, counter);
+
+    pool.invoke([]() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+    EXPECT_FALSE(pool.waitForIdle(std::chrono::milliseconds(1)));
+    EXPECT_TRUE(pool.waitForIdle(std::chrono::seconds(10)));
+    pool.interrupt();
+}
+
+TEST(ThreadPoolQueuedTests, InvokeBatchSplitsIntoContiguousChunks)
+{
+    const size_t N_THREADS = 4;
+    const size_t N_TASKS = 1'000;
+    std::vector<std::thread::id> executedBy(N_TASKS);
+
+    ThreadPoolQueued pool(N_THREADS);
+    pool.run();
+
+    std::vector<ThreadPoolQueued::Func> tasks;
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        tasks.emplace_back([&executedBy, i]() { executedBy[i] = std::this_thread::get_id(); });
+    }
+    pool.invokeBatch(tasks);
+    pool.interrupt();
+
+    const size_t chunkSize = N_TASKS / N_THREADS;
+    std::set<std::thread::id> threads;
+    for (size_t chunk = 0; chunk < N_THREADS; ++chunk) {
+        const auto id = executedBy[chunk * chunkSize];
+        for (size_t i = chunk * chunkSize; i < (chunk + 1) * chunkSize; ++i) {
+            EXPECT_EQ(id, executedBy[i]);
+        }
+        threads.insert(id);
+    }
+    EXPECT_EQ(N_THREADS, threads.size());
+}
+
+TEST(ThreadPoolQueuedTests, BatchDequeueKeepsOrder)
+{
+    const size_t N_TASKS = 10'000;
+    std::vector<size_t> executed;
+    executed.reserve(N_TASKS);
+
+    ThreadPoolQueued::Options options;
+    options.maxBatchSize = 64u;
+    ThreadPoolQueued pool(1, options);
+    pool.run();
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        pool.invoke([&executed, i]() { executed.push_back(i); });
+    }
+    pool.interrupt();
+
+    ASSERT_EQ(N_TASKS, executed.size());
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        EXPECT_EQ(i, executed[i]);
+    }
+}
+
+TEST(ThreadPoolQueuedTests, BoundedQueueAppliesOverflowPolicy)
+{
+    const size_t CAPACITY = 4;
+    const size_t N_TASKS = 10;
+
+    for (auto policy : {OverflowPolicy::REJECT, OverflowPolicy::DROP_OLDEST, OverflowPolicy::BLOCK}) {
+        std::atomic<bool> gate = false;
+        std::atomic<size_t> invoked = 0;
+        std::vector<size_t> executed;
+
+        ThreadPoolQueued::Options options;
+        options.queueCapacity = CAPACITY;
+        options.overflowPolicy = policy;
+        ThreadPoolQueued pool(1, options);
+        pool.run();
+
+        pool.invoke([&gate]() {
+            while (!gate) {
+                std::this_thread::yield();
+            }
+        });
+        while (pool.getWorkload()) {
+            std::this_thread::yield();
+        }
+
+        std::thread producer([&]() {
+            for (size_t i = 0; i < N_TASKS; ++i) {
+                pool.invoke([&executed, i]() { executed.push_back(i); });
+                ++invoked;
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EXPECT_EQ(policy == OverflowPolicy::BLOCK ? CAPACITY : N_TASKS, invoked) << policy;
+        EXPECT_EQ(CAPACITY, pool.getWorkload()) << policy;
+        EXPECT_FALSE(pool.tryInvoke([]() {})) << policy;
+
+        gate = true;
+        producer.join();
+        pool.interrupt();
+
+        const std::map<OverflowPolicy, std::vector<size_t>> expected = {
+            {OverflowPolicy::REJECT, {0, 1, 2, 3}},
+            {OverflowPolicy::DROP_OLDEST, {6, 7, 8, 9}},
+            {OverflowPolicy::BLOCK, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9}},
+        };
+        EXPECT_EQ(expected.at(policy), executed) << policy;
+        EXPECT_EQ(N_TASKS + 1 - expected.at(policy).size(), pool.getRejectedTasks()) << policy;
+    }
+}
+
+TEST(ThreadPoolQueuedTests, DrainAndInterruptImmediatelyHandOverQueuedTasks)
+{
+    const size_t N_TASKS = 8;
+    std::atomic<size_t> counter = 0;
+    std::atomic<bool> gate = false;
+
+    auto startBlocked = [&](ThreadPoolQueued &pool) {
+        gate = false;
+        pool.run();
+        pool.invoke([&gate]() {
+            while (!gate) {
+                std::this_thread::yield();
+            }
+        });
+        while (pool.getWorkload()) {
+            std::this_thread::yield();
+        }
+        for (size_t i = 0; i < N_TASKS; ++i) {
+            pool.invoke([&counter]() { ++counter; });
+        }
+        // gate is opened once pool is stopped, so no queued task may slip through interruptImmediately(),
+        // the pause gives drain() time to count queued tasks
+        return std::thread([&pool, &gate]() {
+            while (pool.isRunning()) {
+                std::this_thread::yield();
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            gate = true;
+        });
+    };
+
+    ThreadPoolQueued drained(1);
+    auto opener = startBlocked(drained);
+    EXPECT_EQ(N_TASKS, drained.drain());
+    opener.join();
+    EXPECT_EQ(N_TASKS, counter);
+    EXPECT_FALSE(drained.isRunning());
+
+    counter = 0;
+    ThreadPoolQueued interrupted(1);
+    opener = startBlocked(interrupted);
+    std::vector<ThreadPoolQueued::Func> tasks;
+    interrupted.interruptImmediately(tasks);
+    opener.join();
+    EXPECT_EQ(0u, counter);
+    EXPECT_EQ(0u, interrupted.getWorkload());
+    EXPECT_EQ(N_TASKS, tasks.size());
+}
+
+TEST(ThreadPoolQueuedTests, KeyedTasksStayOnOneThreadInOrder)
+{
+    const size_t N_THREADS = 4;
+    const size_t N_KEYS = 64;
+    const size_t N_TASKS = 100;
+
+    ThreadPoolQueued pool(N_THREADS);
+    pool.run();
+
+    // tasks of one key never run concurrently, so per key state needs no lock
+    std::vector<std::vector<size_t>> executed(N_KEYS);
+    std::vector<std::set<std::thread::id>> executedBy(N_KEYS);
+    auto invokeAll = [&]() {
+        for (size_t i = 0; i < N_TASKS; ++i) {
+            for (size_t key = 0; key < N_KEYS; ++key) {
+                pool.invoke(key, [&, key, i]() {
+                    executed[key].push_back(i);
+                    executedBy[key].insert(std::this_thread::get_id());
+                });
+            }
+        }
+        ASSERT_TRUE(pool.waitForIdle());
+    };
+    invokeAll();
+
+    std::set<std::thread::id> threads;
+    std::vector<std::thread::id> owners(N_KEYS);
+    for (size_t key = 0; key < N_KEYS; ++key) {
+        ASSERT_EQ(N_TASKS, executed[key].size());
+        for (size_t i = 0; i < N_TASKS; ++i) {
+            EXPECT_EQ(i, executed[key][i]);
+        }
+        ASSERT_EQ(1u, executedBy[key].size());
+        owners[key] = *executedBy[key].begin();
+        threads.insert(owners[key]);
+    }
+    EXPECT_EQ(N_THREADS, threads.size());
+
+    // only keys of crashed thread move
+    std::thread::id crashed;
+    pool.invoke(0u, [&crashed]() {
+        crashed = std::this_thread::get_id();
+        throw std::runtime_error("task failure");
+    });
+    ASSERT_TRUE(pool.waitForIdle());
+
+    for (size_t key = 0; key < N_KEYS; ++key) {
+        executed[key].clear();
+        executedBy[key].clear();
+    }
+    invokeAll();
+    for (size_t key = 0; key < N_KEYS; ++key) {
+        ASSERT_EQ(N_TASKS, executed[key].size());
+        for (size_t i = 0; i < N_TASKS; ++i) {
+            EXPECT_EQ(i, executed[key][i]);
+        }
+        ASSERT_EQ(1u, executedBy[key].size());
+        const auto owner = *executedBy[key].begin();
+        EXPECT_NE(crashed, owner);
+        if (owners[key] != crashed) {
+            EXPECT_EQ(owners[key], owner);
+        }
+    }
+
+    pool.interrupt();
+}
+
+struct ThreadPoolQueuedDispatchTests : TestWithParam<DispatchPolicy> {
+};
+
+TEST_P(ThreadPoolQueuedDispatchTests, TasksAvoidLoadedThread)
+{
+    const size_t N_THREADS = 4;
+    const size_t N_BLOCKERS = 4;
+    const size_t N_TASKS = 200;
+
+    ThreadPoolQueued::Options options;
+    options.dispatchPolicy = GetParam();
+    ThreadPoolQueued pool(N_THREADS, options);
+    pool.run();
+
+    // one thread is stuck with a backlog, round robin would give it every N_THREADS-th task
+    std::atomic<bool> isReleased = false;
+    std::atomic<std::thread::id> loaded;
+    for (size_t i = 0; i < N_BLOCKERS; ++i) {
+        pool.invoke(0u, [&]() {
+            loaded = std::this_thread::get_id();
+            while (!isReleased) {
+                std::this_thread::yield();
+            }
+        });
+    }
+    while (loaded.load() == std::thread::id()) {
+        std::this_thread::yield();
+    }
+
+    // next task is given when the previous one is done, so other threads are never busier than loaded one
+    std::vector<std::promise<void>> executed(N_TASKS);
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        pool.invoke([&executed, i]() { executed[i].set_value(); });
+        if (executed[i].get_future().wait_for(std::chrono::seconds(5)) != std::future_status::ready) {
+            ADD_FAILURE() << "task " << i << " is queued behind loaded thread";
+            break;
+        }
+    }
+
+    isReleased = true;
+    pool.interrupt();
+}
+
+INSTANTIATE_TEST_SUITE_P(DispatchPolicies,
+                         ThreadPoolQueuedDispatchTests,
+                         Values(DispatchPolicy::POWER_OF_TWO_CHOICES, DispatchPolicy::LEAST_LOADED));
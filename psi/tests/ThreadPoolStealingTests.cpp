@@ -0,0 +1,98 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "psi/thread/ThreadPoolStealing.h"
+
+using namespace ::testing;
+using namespace psi::thread;
+
+TEST(ThreadPoolStealingTests, ExecutesAllTasks)
+{
+    const size_t N_TASKS = 10'000;
+    std::atomic<size_t> counter = 0;
+
+    ThreadPoolStealing pool(4);
+    pool.run();
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        pool.invoke([&counter]() { ++counter; });
+    }
+    pool.interrupt();
+
+    EXPECT_EQ(N_TASKS, counter);
+    EXPECT_EQ(0u, pool.getWorkload());
+}
+
+TEST(ThreadPoolStealingTests, ExecutesNestedTasks)
+{
+    // every task spawns two children until depth is reached: 2^(DEPTH + 1) - 1 tasks in total
+    const size_t DEPTH = 12;
+    std::atomic<size_t> counter = 0;
+
+    ThreadPoolStealing pool(4);
+    pool.run();
+
+    std::function<void(size_t)> spawn = [&](size_t depth) {
+        ++counter;
+        if (depth < DEPTH) {
+            pool.invoke([&spawn, depth]() { spawn(depth + 1); });
+            pool.invoke([&spawn, depth]() { spawn(depth + 1); });
+        }
+    };
+    pool.invoke([&spawn]() { spawn(0); });
+
+    const size_t expected = (size_t(1) << (DEPTH + 1)) - 1;
+    while (counter < expected) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    pool.interrupt();
+
+    EXPECT_EQ(expected, counter);
+}
+
+TEST(ThreadPoolStealingTests, InvokeBatchExecutesAllTasks)
+{
+    const size_t N_TASKS = 1'000;
+    std::atomic<size_t> counter = 0;
+
+    ThreadPoolStealing pool(4);
+    pool.run();
+
+    std::vector<ThreadPoolStealing::Func> tasks;
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        tasks.emplace_back([&counter]() { ++counter; });
+    }
+    // from outside and from pool thread
+    pool.invokeBatch(tasks);
+    pool.invoke([&pool, &counter, N_TASKS]() {
+        std::vector<ThreadPoolStealing::Func> nested;
+        for (size_t i = 0; i < N_TASKS; ++i) {
+            nested.emplace_back([&counter]() { ++counter; });
+        }
+        pool.invokeBatch(nested);
+    });
+
+    while (counter < 2 * N_TASKS) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    pool.interrupt();
+
+    EXPECT_EQ(2 * N_TASKS, counter);
+    EXPECT_EQ(0u, pool.getWorkload());
+}
+
+TEST(ThreadPoolStealingTests, InterruptImmediatelyDropsQueue)
+{
+    std::atomic<size_t> counter = 0;
+
+    ThreadPoolStealing pool(1);
+    pool.run();
+    pool.invoke([]() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+    for (size_t i = 0; i < 100; ++i) {
+        pool.invoke([&counter]() { ++counter; });
+    }
+    pool.interruptImmediately();
+
+    EXPECT_GT(100u, counter);
+    EXPECT_EQ(0u, pool.getWorkload());
+    EXPECT_FALSE(pool.isRunning());
+}
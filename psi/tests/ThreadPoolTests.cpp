@@ -0,0 +1,856 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "psi/thread/ThreadPool.h"
+
+using namespace ::testing;
+using namespace psi::thread;
+
+namespace {
+/// Pool whose workers are kept busy until open() is called, so tests may fill its queues first
+class GatedPool : public ThreadPool
+{
+public:
+    explicit GatedPool(const ThreadPool::Options &options = ThreadPool::Options(), size_t numberOfThreads = 1u)
+        : ThreadPool(numberOfThreads, options)
+    {
+        run();
+        for (size_t i = 0; i < numberOfThreads; ++i) {
+            invoke([this]() {
+                while (!m_gate) {
+                    std::this_thread::yield();
+                }
+            });
+        }
+        // every worker has taken its gate task
+        while (getWorkload()) {
+            std::this_thread::yield();
+        }
+    }
+
+    ~GatedPool() override
+    {
+        // workers are joined while the gate still exists
+        open();
+        interrupt();
+    }
+
+    void open()
+    {
+        m_gate = true;
+    }
+
+    /// Opens the gate from another thread once intake is stopped and delay passed
+    std::thread openWhenStopped(std::chrono::milliseconds delay = std::chrono::milliseconds::zero())
+    {
+        return std::thread([this, delay]() {
+            while (isRunning()) {
+                std::this_thread::yield();
+            }
+            std::this_thread::sleep_for(delay);
+            open();
+        });
+    }
+
+private:
+    std::atomic<bool> m_gate = false;
+};
+} // namespace
+
+struct ThreadPoolTests : TestWithParam<std::tuple<ThreadPool::QueueBackend, IdlePolicy>> {
+    ThreadPool::Options options()
+    {
+        ThreadPool::Options result;
+        result.queueBackend = std::get<0>(GetParam());
+        result.idlePolicy = std::get<1>(GetParam());
+        result.queueCapacity = 16u;
+        return result;
+    }
+};
+
+TEST_P(ThreadPoolTests, ExecutesAllTasksFromMultipleProducers)
+{
+    const size_t N_PRODUCERS = 4;
+    const size_t N_TASKS = 10'000;
+    std::atomic<size_t> counter = 0;
+
+    ThreadPool pool(4, options());
+    pool.run();
+
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < N_PRODUCERS; ++p) {
+        producers.emplace_back([&pool, &counter]() {
+            for (size_t i = 0; i < N_TASKS; ++i) {
+                pool.invoke([&counter]() { ++counter; });
+            }
+        });
+    }
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    pool.interrupt();
+
+    EXPECT_EQ(N_PRODUCERS * N_TASKS, counter);
+    EXPECT_EQ(0u, pool.getWorkload());
+}
+
+TEST_P(ThreadPoolTests, InvokeBatchExecutesAllTasks)
+{
+    const size_t N_TASKS = 1'000;
+    std::atomic<size_t> counter = 0;
+
+    ThreadPool pool(4, options());
+    pool.run();
+
+    std::vector<ThreadPool::Func> tasks;
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        tasks.emplace_back([&counter]() { ++counter; });
+    }
+    pool.invokeBatch(tasks);
+    pool.interrupt();
+
+    EXPECT_EQ(N_TASKS, counter);
+    EXPECT_EQ(0u, pool.getWorkload());
+}
+
+TEST_P(ThreadPoolTests, InterruptImmediatelyDropsQueue)
+{
+    std::atomic<size_t> counter = 0;
+
+    ThreadPool pool(1, options());
+    pool.run();
+    pool.invoke([]() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+    for (size_t i = 0; i < 10; ++i) {
+        pool.invoke([&counter]() { ++counter; });
+    }
+    pool.interruptImmediately();
+
+    EXPECT_GT(10u, counter);
+    EXPECT_FALSE(pool.isRunning());
+}
+
+TEST_P(ThreadPoolTests, InterruptImmediatelyHandsBackUnexecutedTasks)
+{
+    std::atomic<size_t> counter = 0;
+
+    GatedPool pool(options());
+    for (size_t i = 0; i < 10; ++i) {
+        pool.invoke([&counter]() { ++counter; });
+    }
+
+    // gate is opened once pool is stopped, so no queued task may slip through
+    auto opener = pool.openWhenStopped();
+    std::vector<ThreadPool::Func> tasks;
+    pool.interruptImmediately(tasks);
+    opener.join();
+
+    EXPECT_EQ(0u, counter);
+    EXPECT_EQ(0u, pool.getWorkload());
+    ASSERT_EQ(10u, tasks.size());
+    for (auto &fn : tasks) {
+        fn();
+    }
+    EXPECT_EQ(10u, counter);
+}
+
+TEST_P(ThreadPoolTests, WaitForIdleReturnsWhenAllTasksAreDone)
+{
+    const size_t N_TASKS = 1'000;
+    std::atomic<size_t> counter = 0;
+
+    ThreadPool pool(4, options());
+    pool.run();
+    EXPECT_TRUE(pool.waitForIdle());
+
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        pool.invoke([&pool, &counter]() {
+            // workers spawn tasks as well
+            pool.invoke([&counter]() { ++counter; });
+        });
+    }
+    EXPECT_TRUE(pool.waitForIdle());
+    EXPECT_EQ(N_TASKS, counter);
+
+    pool.invoke([]() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+    EXPECT_FALSE(pool.waitForIdle(std::chrono::milliseconds(1)));
+    EXPECT_TRUE(pool.waitForIdle(std::chrono::seconds(10)));
+    pool.interrupt();
+}
+
+TEST_P(ThreadPoolTests, DrainExecutesQueuedTasksAndStopsIntake)
+{
+    const size_t N_TASKS = 10;
+    std::atomic<size_t> counter = 0;
+
+    GatedPool pool(options());
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        pool.invoke([&counter]() { ++counter; });
+    }
+
+    // gate is opened once intake is stopped and a moment later, when drain() has counted queued tasks
+    auto opener = pool.openWhenStopped(std::chrono::milliseconds(10));
+    EXPECT_EQ(N_TASKS, pool.drain());
+    opener.join();
+
+    EXPECT_EQ(N_TASKS, counter);
+    EXPECT_FALSE(pool.isRunning());
+    pool.invoke([&counter]() { ++counter; });
+    EXPECT_EQ(0u, pool.getWorkload());
+}
+
+TEST_P(ThreadPoolTests, PriorityLanesAreServedInOrder)
+{
+    using Priority = ThreadPool::Priority;
+
+    std::vector<Priority> order;
+
+    // the only thread is kept busy until all lanes are filled
+    GatedPool pool(options());
+
+    for (auto priority : {Priority::BACKGROUND, Priority::NORMAL, Priority::CRITICAL}) {
+        for (size_t i = 0; i < 3; ++i) {
+            pool.invoke([&order, priority]() { order.push_back(priority); }, priority);
+        }
+    }
+    EXPECT_EQ(3u, pool.getWorkload(Priority::CRITICAL));
+    EXPECT_EQ(3u, pool.getWorkload(Priority::NORMAL));
+    EXPECT_EQ(3u, pool.getWorkload(Priority::BACKGROUND));
+    EXPECT_EQ(9u, pool.getWorkload());
+
+    pool.open();
+    pool.interrupt();
+
+    const std::vector<Priority> expected = {Priority::CRITICAL,
+                                            Priority::CRITICAL,
+                                            Priority::CRITICAL,
+                                            Priority::NORMAL,
+                                            Priority::NORMAL,
+                                            Priority::NORMAL,
+                                            Priority::BACKGROUND,
+                                            Priority::BACKGROUND,
+                                            Priority::BACKGROUND};
+    EXPECT_EQ(expected, order);
+}
+
+TEST_P(ThreadPoolTests, AgingPreventsStarvationOfNormalLane)
+{
+    using Priority = ThreadPool::Priority;
+
+    std::vector<Priority> order;
+
+    auto poolOptions = options();
+    poolOptions.agingLimit = 2u;
+    GatedPool pool(poolOptions);
+
+    for (size_t i = 0; i < 2; ++i) {
+        pool.invoke([&order]() { order.push_back(Priority::NORMAL); }, Priority::NORMAL);
+    }
+    for (size_t i = 0; i < 6; ++i) {
+        pool.invoke([&order]() { order.push_back(Priority::CRITICAL); }, Priority::CRITICAL);
+    }
+
+    pool.open();
+    pool.interrupt();
+
+    const std::vector<Priority> expected = {Priority::CRITICAL,
+                                            Priority::CRITICAL,
+                                            Priority::NORMAL,
+                                            Priority::CRITICAL,
+                                            Priority::CRITICAL,
+                                            Priority::NORMAL,
+                                            Priority::CRITICAL,
+                                            Priority::CRITICAL};
+    EXPECT_EQ(expected, order);
+}
+
+TEST_P(ThreadPoolTests, TaskSpawnedByWorkerRunsNext)
+{
+    std::atomic<size_t> counter = 0;
+    std::vector<std::string> order;
+
+    GatedPool pool(options());
+    pool.invoke([&]() {
+        order.push_back("parent");
+        pool.invoke([&]() {
+            order.push_back("child");
+            ++counter;
+        });
+    });
+    for (size_t i = 0; i < 2; ++i) {
+        pool.invoke([&]() {
+            order.push_back("queued");
+            ++counter;
+        });
+    }
+
+    // pool must be running while parent spawns child
+    pool.open();
+    while (counter < 3u) {
+        std::this_thread::yield();
+    }
+    pool.interrupt();
+
+    const std::vector<std::string> expected = {"parent", "child", "queued", "queued"};
+    EXPECT_EQ(expected, order);
+}
+
+TEST_P(ThreadPoolTests, LocalTaskIsStolenByIdleWorker)
+{
+    std::atomic<bool> isChildDone = false;
+    std::atomic<bool> isParentDone = false;
+
+    ThreadPool pool(2, options());
+    pool.run();
+
+    // parent blocks its worker until child is done, so child can only run on the other worker
+    pool.invoke([&]() {
+        pool.invoke([&isChildDone]() { isChildDone = true; });
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!isChildDone && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        isParentDone = true;
+    });
+
+    while (!isParentDone) {
+        std::this_thread::yield();
+    }
+    pool.interrupt();
+    EXPECT_TRUE(isChildDone);
+    EXPECT_EQ(0u, pool.getWorkload());
+}
+
+TEST(ThreadPoolLocalQueueTests, DisabledLocalQueuesKeepFifoOrder)
+{
+    std::atomic<size_t> counter = 0;
+    std::vector<std::string> order;
+
+    ThreadPool::Options options;
+    options.localQueues = false;
+    GatedPool pool(options);
+    pool.invoke([&]() {
+        pool.invoke([&]() {
+            order.push_back("child");
+            ++counter;
+        });
+    });
+    pool.invoke([&]() {
+        order.push_back("queued");
+        ++counter;
+    });
+
+    pool.open();
+    while (counter < 2u) {
+        std::this_thread::yield();
+    }
+    pool.interrupt();
+
+    const std::vector<std::string> expected = {"queued", "child"};
+    EXPECT_EQ(expected, order);
+}
+
+TEST(ThreadPoolBatchTests, BatchDequeueExecutesAllTasks)
+{
+    const size_t N_TASKS = 10'000;
+    std::atomic<size_t> counter = 0;
+
+    ThreadPool::Options options;
+    options.maxBatchSize = 32u;
+    ThreadPool pool(4, options);
+    pool.run();
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        pool.invoke([&counter]() { ++counter; });
+    }
+    pool.interrupt();
+
+    EXPECT_EQ(N_TASKS, counter);
+}
+
+TEST(ThreadPoolBatchTests, CrashedThreadRequeuesRestOfBatch)
+{
+    const size_t N_TASKS = 100;
+    std::atomic<size_t> counter = 0;
+
+    // both threads are kept busy until whole backlog is queued
+    ThreadPool::Options options;
+    options.maxBatchSize = 16u;
+    GatedPool pool(options, 2u);
+    pool.invoke([]() { throw std::runtime_error("task failure"); });
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        pool.invoke([&counter]() { ++counter; });
+    }
+    pool.open();
+
+    while (counter < N_TASKS) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    pool.interrupt();
+
+    EXPECT_EQ(N_TASKS, counter);
+}
+
+TEST(ThreadPoolElasticTests, SupportsMoreThan255Threads)
+{
+    const size_t N_THREADS = 300;
+    std::atomic<size_t> counter = 0;
+
+    ThreadPool pool(N_THREADS);
+    pool.run();
+    EXPECT_EQ(N_THREADS, pool.getNumberOfThreads());
+
+    for (size_t i = 0; i < N_THREADS; ++i) {
+        pool.invoke([&counter]() { ++counter; });
+    }
+    pool.interrupt();
+
+    EXPECT_EQ(N_THREADS, counter);
+}
+
+TEST(ThreadPoolElasticTests, MaxThreadsLessThanMinThrows)
+{
+    ThreadPool::Options options;
+    options.maxThreads = 2u;
+    EXPECT_THROW(ThreadPool(4, options), std::invalid_argument);
+}
+
+struct ThreadPoolElasticIdleTests : TestWithParam<IdlePolicy> {
+};
+
+TEST_P(ThreadPoolElasticIdleTests, GrowsUnderBlockingLoadAndShrinksWhenIdle)
+{
+    const size_t N_TASKS = 400;
+    std::atomic<size_t> counter = 0;
+
+    // spinning and polling workers are idle as well, though they do not park
+    ThreadPool::Options options;
+    options.idlePolicy = GetParam();
+    options.maxThreads = 8u;
+    options.controlInterval = std::chrono::milliseconds(10);
+    options.idleTimeout = std::chrono::milliseconds(50);
+    ThreadPool pool(1, options);
+    pool.run();
+
+    // blocking tasks: more threads give more throughput
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        pool.invoke([&counter]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            ++counter;
+        });
+    }
+
+    size_t maxThreads = 0u;
+    while (counter < N_TASKS) {
+        maxThreads = std::max(maxThreads, pool.getNumberOfThreads());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_GT(maxThreads, 1u);
+    EXPECT_LE(maxThreads, 8u);
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (pool.getNumberOfThreads() > 1u && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(1u, pool.getNumberOfThreads());
+
+    // remaining thread still works
+    EXPECT_EQ(1, pool.submit([]() { return 1; }).get());
+    pool.interrupt();
+}
+
+INSTANTIATE_TEST_SUITE_P(IdlePolicies,
+                         ThreadPoolElasticIdleTests,
+                         Values(IdlePolicy::BLOCK, IdlePolicy::SPIN_THEN_PARK, IdlePolicy::BUSY_POLL));
+
+INSTANTIATE_TEST_SUITE_P(QueueBackendsAndIdlePolicies,
+                         ThreadPoolTests,
+                         Combine(Values(ThreadPool::QueueBackend::MUTEX, ThreadPool::QueueBackend::LOCK_FREE),
+                                 Values(IdlePolicy::BLOCK, IdlePolicy::SPIN_THEN_PARK, IdlePolicy::BUSY_POLL)));
+
+struct ThreadPoolOverflowTests : TestWithParam<ThreadPool::QueueBackend> {
+    static constexpr size_t CAPACITY = 4u;
+    static constexpr size_t N_TASKS = 10u;
+
+    void start(OverflowPolicy policy)
+    {
+        ThreadPool::Options options;
+        options.queueBackend = GetParam();
+        options.queueCapacity = CAPACITY;
+        options.maxQueueSize = CAPACITY;
+        options.overflowPolicy = policy;
+        options.localQueues = localQueues;
+        executed.clear();
+        pool = std::make_unique<GatedPool>(options);
+    }
+
+    void invokeAll()
+    {
+        for (size_t i = 0; i < N_TASKS; ++i) {
+            pool->invoke([this, i]() { executed.push_back(i); });
+        }
+    }
+
+    std::vector<size_t> finish()
+    {
+        pool->open();
+        pool->interrupt();
+        return executed;
+    }
+
+    bool localQueues = true;
+    std::vector<size_t> executed;
+    std::unique_ptr<GatedPool> pool;
+};
+
+TEST_P(ThreadPoolOverflowTests, RejectDropsNewTasks)
+{
+    start(OverflowPolicy::REJECT);
+    invokeAll();
+    EXPECT_EQ(CAPACITY, pool->getWorkload());
+    EXPECT_FALSE(pool->tryInvoke([]() {}));
+    EXPECT_EQ(N_TASKS - CAPACITY + 1, pool->getRejectedTasks());
+
+    const std::vector<size_t> expected = {0, 1, 2, 3};
+    EXPECT_EQ(expected, finish());
+}
+
+TEST_P(ThreadPoolOverflowTests, DropOldestKeepsNewTasks)
+{
+    start(OverflowPolicy::DROP_OLDEST);
+    invokeAll();
+    EXPECT_EQ(N_TASKS - CAPACITY, pool->getRejectedTasks());
+
+    const std::vector<size_t> expected = {6, 7, 8, 9};
+    EXPECT_EQ(expected, finish());
+}
+
+TEST_P(ThreadPoolOverflowTests, CallerRunsOverflowingTasks)
+{
+    start(OverflowPolicy::CALLER_RUNS);
+    invokeAll();
+    EXPECT_EQ(N_TASKS - CAPACITY, pool->getRejectedTasks());
+
+    const std::vector<size_t> expected = {4, 5, 6, 7, 8, 9, 0, 1, 2, 3};
+    EXPECT_EQ(expected, finish());
+}
+
+TEST_P(ThreadPoolOverflowTests, BlockWaitsForSpace)
+{
+    start(OverflowPolicy::BLOCK);
+
+    std::atomic<size_t> invoked = 0;
+    std::thread producer([&]() {
+        for (size_t i = 0; i < N_TASKS; ++i) {
+            pool->invoke([this, i]() { executed.push_back(i); });
+            ++invoked;
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(CAPACITY, invoked);
+    EXPECT_FALSE(pool->tryInvoke([]() {}));
+
+    pool->open();
+    producer.join();
+    EXPECT_EQ(N_TASKS, invoked);
+    EXPECT_EQ(1u, pool->getRejectedTasks());
+
+    const std::vector<size_t> expected = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    EXPECT_EQ(expected, finish());
+}
+
+TEST_P(ThreadPoolOverflowTests, BlockFromWorkerRunsTaskInPlace)
+{
+    // without local queues every task of worker goes to the full shared queue, waiting for space would deadlock
+    localQueues = false;
+    start(OverflowPolicy::BLOCK);
+
+    std::promise<void> spawned;
+    pool->invoke([this, &spawned]() {
+        invokeAll();
+        spawned.set_value();
+    });
+    pool->open();
+    EXPECT_EQ(std::future_status::ready, spawned.get_future().wait_for(std::chrono::seconds(10)));
+    EXPECT_EQ(N_TASKS - CAPACITY, pool->getRejectedTasks());
+
+    const std::vector<size_t> expected = {4, 5, 6, 7, 8, 9, 0, 1, 2, 3};
+    EXPECT_EQ(expected, finish());
+}
+
+TEST_P(ThreadPoolOverflowTests, FanOutOfWorkerIsBounded)
+{
+    // tasks spawned by worker go to its local queue, they count against capacity as well
+    for (auto policy : {OverflowPolicy::REJECT, OverflowPolicy::DROP_OLDEST}) {
+        start(policy);
+
+        size_t workload = 0u;
+        bool isInvoked = true;
+        std::promise<void> spawned;
+        pool->invoke([&]() {
+            invokeAll();
+            workload = pool->getWorkload();
+            isInvoked = pool->tryInvoke([]() {});
+            spawned.set_value();
+        });
+        pool->open();
+        EXPECT_EQ(std::future_status::ready, spawned.get_future().wait_for(std::chrono::seconds(10)));
+        EXPECT_EQ(CAPACITY, workload);
+        EXPECT_FALSE(isInvoked);
+        EXPECT_EQ(N_TASKS - CAPACITY + 1, pool->getRejectedTasks());
+
+        // the latest task is in LIFO slot
+        const std::vector<size_t> expected = {3, 0, 1, 2};
+        EXPECT_EQ(expected, finish());
+    }
+}
+
+TEST_P(ThreadPoolOverflowTests, DroppedDeadlineTaskCallsOnExpired)
+{
+    const auto deadline = ThreadPool::Clock::now() + std::chrono::hours(1);
+    for (auto policy : {OverflowPolicy::REJECT, OverflowPolicy::DROP_OLDEST}) {
+        start(policy);
+
+        // the first CAPACITY tasks are the ones queued under REJECT and the oldest ones under DROP_OLDEST
+        std::atomic<size_t> expired = 0;
+        for (size_t i = 0; i < N_TASKS; ++i) {
+            pool->invoke([this, i]() { executed.push_back(i); }, deadline, [&expired]() { ++expired; });
+        }
+        EXPECT_EQ(N_TASKS - CAPACITY, expired) << policy;
+        EXPECT_EQ(N_TASKS - CAPACITY, pool->getRejectedTasks()) << policy;
+        EXPECT_EQ(CAPACITY, finish().size()) << policy;
+        EXPECT_EQ(0u, pool->getExpiredTasks()) << policy;
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(QueueBackends,
+                         ThreadPoolOverflowTests,
+                         Values(ThreadPool::QueueBackend::MUTEX, ThreadPool::QueueBackend::LOCK_FREE));
+
+TEST(ThreadPoolControlledDelayTests, OverloadShedsSheddableTasks)
+{
+    const size_t N_TASKS = 200u;
+
+    ThreadPool::Options options;
+    options.targetDelay = std::chrono::milliseconds(1);
+    options.delayInterval = std::chrono::milliseconds(10);
+    ThreadPool pool(1, options);
+    pool.run();
+
+    // every task takes 1ms, so delay of queue grows by 1ms per task
+    std::atomic<size_t> executed = 0;
+    std::atomic<size_t> shed = 0;
+    std::atomic<size_t> executedRegular = 0;
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        pool.invokeSheddable(
+            [&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                ++executed;
+            },
+            [&]() { ++shed; });
+        pool.invoke([&]() { ++executedRegular; });
+    }
+    pool.interrupt();
+
+    EXPECT_EQ(N_TASKS, executedRegular);
+    EXPECT_EQ(N_TASKS, executed + shed);
+    EXPECT_LT(0u, shed.load());
+    EXPECT_EQ(shed, pool.getShedTasks());
+}
+
+TEST(ThreadPoolControlledDelayTests, NothingIsShedWhenDisabled)
+{
+    const size_t N_TASKS = 50u;
+
+    ThreadPool pool(1);
+    pool.run();
+
+    std::atomic<size_t> executed = 0;
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        pool.invokeSheddable(
+            [&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                ++executed;
+            },
+            []() { FAIL() << "task must not be shed"; });
+    }
+    pool.interrupt();
+
+    EXPECT_EQ(N_TASKS, executed);
+    EXPECT_EQ(0u, pool.getShedTasks());
+}
+
+TEST(ThreadPoolControlledDelayTests, OverflowCallsOnShedOfDroppedTask)
+{
+    ThreadPool::Options options;
+    options.maxQueueSize = 1u;
+    options.overflowPolicy = OverflowPolicy::DROP_OLDEST;
+    GatedPool pool(options);
+
+    std::vector<size_t> events;
+    pool.invokeSheddable([&]() { events.push_back(0); }, [&]() { events.push_back(10); });
+    pool.invokeSheddable([&]() { events.push_back(1); }, [&]() { events.push_back(11); });
+    pool.open();
+    pool.interrupt();
+
+    const std::vector<size_t> expected = {10, 1};
+    EXPECT_EQ(expected, events);
+    EXPECT_EQ(1u, pool.getRejectedTasks());
+}
+
+struct ThreadPoolDeadlineTests : TestWithParam<std::tuple<ThreadPool::QueueBackend, bool>> {
+    void start()
+    {
+        ThreadPool::Options options;
+        options.queueBackend = std::get<0>(GetParam());
+        options.earliestDeadlineFirst = std::get<1>(GetParam());
+        pool = std::make_unique<GatedPool>(options);
+    }
+
+    std::vector<std::string> finish()
+    {
+        pool->open();
+        pool->interrupt();
+        return events;
+    }
+
+    std::vector<std::string> events;
+    std::unique_ptr<GatedPool> pool;
+};
+
+TEST_P(ThreadPoolDeadlineTests, ExpiredTaskIsNotRun)
+{
+    start();
+    const auto now = ThreadPool::Clock::now();
+    pool->invoke([this]() { events.push_back("expired"); },
+                 now + std::chrono::milliseconds(1),
+                 [this]() { events.push_back("onExpired"); });
+    pool->invoke([this]() { events.push_back("alive"); },
+                 now + std::chrono::seconds(10),
+                 [this]() { events.push_back("onExpired alive"); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    const std::vector<std::string> expected = {"onExpired", "alive"};
+    EXPECT_EQ(expected, finish());
+    EXPECT_EQ(1u, pool->getExpiredTasks());
+}
+
+INSTANTIATE_TEST_SUITE_P(QueueModes,
+                         ThreadPoolDeadlineTests,
+                         Values(std::make_tuple(ThreadPool::QueueBackend::MUTEX, false),
+                                std::make_tuple(ThreadPool::QueueBackend::MUTEX, true),
+                                std::make_tuple(ThreadPool::QueueBackend::LOCK_FREE, false)));
+
+struct ThreadPoolEarliestDeadlineFirstTests : ThreadPoolDeadlineTests {
+};
+
+TEST_P(ThreadPoolEarliestDeadlineFirstTests, NearestDeadlineRunsFirst)
+{
+    start();
+    const auto now = ThreadPool::Clock::now();
+    pool->invoke([this]() { events.push_back("none"); });
+    for (size_t seconds : {5u, 1u, 3u, 1u}) {
+        const auto name = std::to_string(seconds) + "s";
+        pool->invoke([this, name]() { events.push_back(name); }, now + std::chrono::seconds(seconds));
+    }
+    pool->invoke([this]() { events.push_back("none again"); });
+
+    const std::vector<std::string> expected = {"1s", "1s", "3s", "5s", "none", "none again"};
+    EXPECT_EQ(expected, finish());
+    EXPECT_EQ(0u, pool->getExpiredTasks());
+}
+
+INSTANTIATE_TEST_SUITE_P(QueueModes,
+                         ThreadPoolEarliestDeadlineFirstTests,
+                         Values(std::make_tuple(ThreadPool::QueueBackend::MUTEX, true)));
+
+TEST(ThreadPoolTenantTests, TenantsShareThreadsByWeight)
+{
+    const size_t N_ROUNDS = 10u;
+    std::string order;
+
+    GatedPool pool;
+    pool.setTenantWeight(1u, 3u);
+
+    // tenant 1 floods the queue first, but tenant 2 still gets every 4th turn
+    for (size_t i = 0; i < 3u * N_ROUNDS; ++i) {
+        pool.invoke(1u, [&]() { order += '1'; });
+    }
+    for (size_t i = 0; i < N_ROUNDS; ++i) {
+        pool.invoke(2u, [&]() { order += '2'; });
+    }
+    EXPECT_EQ(3u * N_ROUNDS, pool.getTenantStats(1u).queued);
+    EXPECT_EQ(N_ROUNDS, pool.getTenantStats(2u).queued);
+
+    pool.open();
+    pool.interrupt();
+
+    std::string expected;
+    for (size_t i = 0; i < N_ROUNDS; ++i) {
+        expected += "1112";
+    }
+    EXPECT_EQ(expected, order);
+    EXPECT_EQ(0u, pool.getTenantStats(1u).queued);
+    EXPECT_EQ(3u * N_ROUNDS, pool.getTenantStats(1u).executed);
+    EXPECT_EQ(N_ROUNDS, pool.getTenantStats(2u).executed);
+    EXPECT_EQ(0u, pool.getTenantStats(3u).executed);
+    EXPECT_THROW(pool.setTenantWeight(1u, 0u), std::invalid_argument);
+}
+
+struct ThreadPoolDropOldestTests : Test {
+    /// queue holds 3 tasks
+    void start(bool isEarliestDeadlineFirst)
+    {
+        ThreadPool::Options options;
+        options.maxQueueSize = 3u;
+        options.overflowPolicy = OverflowPolicy::DROP_OLDEST;
+        options.earliestDeadlineFirst = isEarliestDeadlineFirst;
+        pool = std::make_unique<GatedPool>(options);
+    }
+
+    std::vector<std::string> finish()
+    {
+        pool->open();
+        pool->interrupt();
+        return events;
+    }
+
+    std::vector<std::string> events;
+    std::unique_ptr<GatedPool> pool;
+};
+
+TEST_F(ThreadPoolDropOldestTests, EarliestDeadlineFirstDropsLeastUrgentTask)
+{
+    start(true);
+    const auto now = ThreadPool::Clock::now();
+    for (size_t seconds : {10u, 30u, 20u, 5u}) {
+        const auto name = std::to_string(seconds) + "s";
+        pool->invoke([this, name]() { events.push_back(name); },
+                     now + std::chrono::seconds(seconds),
+                     [this, name]() { events.push_back("dropped " + name); });
+    }
+
+    const std::vector<std::string> expected = {"dropped 30s", "5s", "10s", "20s"};
+    EXPECT_EQ(expected, finish());
+    EXPECT_EQ(1u, pool->getRejectedTasks());
+}
+
+TEST_F(ThreadPoolDropOldestTests, FloodingTenantLosesItsTask)
+{
+    start(false);
+    pool->invoke(1u, [this]() { events.push_back("quiet"); });
+    pool->invoke(2u, [this]() { events.push_back("flood 1"); });
+    pool->invoke(2u, [this]() { events.push_back("flood 2"); });
+    pool->invoke(2u, [this]() { events.push_back("flood 3"); });
+
+    const std::vector<std::string> expected = {"quiet", "flood 2", "flood 3"};
+    EXPECT_EQ(expected, finish());
+    EXPECT_EQ(1u, pool->getRejectedTasks());
+}
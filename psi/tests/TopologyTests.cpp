@@ -0,0 +1,75 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "psi/thread/ThreadPool.h"
+#include "psi/thread/ThreadPoolQueued.h"
+#include "psi/thread/Topology.h"
+
+using namespace ::testing;
+using namespace psi::thread;
+
+TEST(TopologyTests, ParsesCpuList)
+{
+    EXPECT_EQ(CpuSet({0, 1, 2, 3, 8, 10, 11}), Topology::parseCpuList("0-3,8,10-11\n"));
+    EXPECT_EQ(CpuSet({5}), Topology::parseCpuList("5"));
+    EXPECT_EQ(CpuSet({1, 2}), Topology::parseCpuList("2,1,1-2"));
+    EXPECT_TRUE(Topology::parseCpuList("").empty());
+}
+
+TEST(TopologyTests, ParsesCgroupCpuMax)
+{
+    EXPECT_EQ(0u, Topology::parseCpuMax("max 100000"));
+    EXPECT_EQ(2u, Topology::parseCpuMax("200000 100000"));
+    EXPECT_EQ(2u, Topology::parseCpuMax("150000 100000"));
+    EXPECT_EQ(1u, Topology::parseCpuMax("50000 100000"));
+    // cgroup v1: no limit
+    EXPECT_EQ(0u, Topology::parseCpuMax("-1 100000"));
+    EXPECT_EQ(0u, Topology::parseCpuMax(""));
+}
+
+TEST(TopologyTests, DescribesCurrentMachine)
+{
+    const auto cpus = Topology::availableCpus();
+    ASSERT_FALSE(cpus.empty());
+    EXPECT_TRUE(std::is_sorted(cpus.begin(), cpus.end()));
+
+    const size_t defaultThreads = Topology::defaultNumberOfThreads();
+    EXPECT_GE(defaultThreads, 1u);
+    EXPECT_LE(defaultThreads, cpus.size());
+
+    const auto nodes = Topology::numaNodes();
+    ASSERT_FALSE(nodes.empty());
+    size_t nodeCpus = 0u;
+    for (const auto &node : nodes) {
+        EXPECT_FALSE(node.cpus.empty());
+        nodeCpus += node.cpus.size();
+    }
+    EXPECT_LE(nodeCpus, cpus.size());
+}
+
+TEST(TopologyTests, PoolThreadsArePinned)
+{
+    const auto cpus = Topology::availableCpus();
+    const CpuSet pinnedCpu = {cpus.back()};
+
+    ThreadPool::Options options;
+    options.cpuSets = {pinnedCpu};
+    ThreadPool pool(2, options);
+    pool.run();
+
+    ThreadPoolQueued::Options queuedOptions;
+    queuedOptions.cpuSets = {pinnedCpu};
+    ThreadPoolQueued queuedPool(2, queuedOptions);
+    queuedPool.run();
+
+#ifdef __linux__
+    EXPECT_EQ(pinnedCpu, pool.submit([]() { return Topology::availableCpus(); }).get());
+    EXPECT_EQ(pinnedCpu, queuedPool.submit([]() { return Topology::availableCpus(); }).get());
+#endif
+
+    pool.interrupt();
+    queuedPool.interrupt();
+}
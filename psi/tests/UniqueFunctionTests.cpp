@@ -0,0 +1,245 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <future>
+#include <memory>
+
+#include "psi/thread/RingQueue.h"
+#include "psi/thread/TaskGraph.h"
+#include "psi/thread/ThreadPool.h"
+#include "psi/thread/ThreadPoolQueued.h"
+#include "psi/thread/UniqueFunction.h"
+
+using namespace ::testing;
+using namespace psi::thread;
+
+namespace {
+std::atomic<size_t> g_allocations = 0;
+}
+
+// replaced global allocation functions count every heap allocation made by the test binary
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void *operator new(size_t size)
+{
+    ++g_allocations;
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    ::operator delete(ptr);
+}
+
+TEST(UniqueFunctionTests, SmallCallableIsStoredInline)
+{
+    std::array<char, 48> payload {};
+    size_t result = 0;
+
+    const size_t before = g_allocations;
+    UniqueFunction<void()> fn([payload, &result]() { result = payload.size(); });
+    UniqueFunction<void()> moved(std::move(fn));
+    moved();
+    const size_t after = g_allocations;
+
+    EXPECT_EQ(before, after);
+    EXPECT_EQ(48u, result);
+    EXPECT_FALSE(fn);
+    EXPECT_TRUE(moved);
+}
+
+TEST(UniqueFunctionTests, BigCallableIsAllocatedOnce)
+{
+    std::array<char, 256> payload {};
+    size_t result = 0;
+
+    const size_t before = g_allocations;
+    UniqueFunction<void()> fn([payload, &result]() { result = payload.size(); });
+    UniqueFunction<void()> moved(std::move(fn));
+    UniqueFunction<void()> movedAgain;
+    movedAgain = std::move(moved);
+    movedAgain();
+    const size_t after = g_allocations;
+
+    EXPECT_EQ(before + 1, after);
+    EXPECT_EQ(256u, result);
+}
+
+TEST(UniqueFunctionTests, HoldsMoveOnlyCallables)
+{
+    auto value = std::make_unique<int>(42);
+    std::promise<int> promise;
+    auto future = promise.get_future();
+
+    UniqueFunction<void()> fn([value = std::move(value), promise = std::move(promise)]() mutable {
+        promise.set_value(*value);
+    });
+    fn();
+
+    EXPECT_EQ(42, future.get());
+}
+
+TEST(UniqueFunctionTests, ReturnsValueAndForwardsArguments)
+{
+    UniqueFunction<int(int, std::unique_ptr<int>)> fn([](int a, std::unique_ptr<int> b) { return a + *b; });
+    EXPECT_EQ(5, fn(2, std::make_unique<int>(3)));
+}
+
+TEST(UniqueFunctionTests, EmptyStdFunctionProducesEmptyFunction)
+{
+    std::function<void()> empty;
+    UniqueFunction<void()> fn(empty);
+    EXPECT_FALSE(fn);
+    EXPECT_TRUE(fn == nullptr);
+    EXPECT_THROW(fn(), std::bad_function_call);
+}
+
+TEST(UniqueFunctionTests, DestroysCapturedState)
+{
+    auto value = std::make_shared<int>(1);
+    {
+        UniqueFunction<void()> fn([value]() {});
+        EXPECT_EQ(2, value.use_count());
+        fn = nullptr;
+        EXPECT_EQ(1, value.use_count());
+        fn = [value]() {};
+        EXPECT_EQ(2, value.use_count());
+    }
+    EXPECT_EQ(1, value.use_count());
+}
+
+TEST(UniqueFunctionTests, RingQueueReusesStorage)
+{
+    RingQueue<UniqueFunction<void()>> queue;
+    queue.reserve(64);
+    int counter = 0;
+
+    const size_t before = g_allocations;
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 64; ++i) {
+            queue.emplace([&counter]() { ++counter; });
+        }
+        while (!queue.empty()) {
+            queue.front()();
+            queue.pop();
+        }
+    }
+    const size_t after = g_allocations;
+
+    EXPECT_EQ(before, after);
+    EXPECT_EQ(640, counter);
+}
+
+template <typename Pool>
+size_t countPoolAllocations(Pool &pool)
+{
+    const size_t N_TASKS = 1'000;
+    std::atomic<size_t> counter = 0;
+    std::array<char, 32> payload {};
+
+    auto submitAndWait = [&]() {
+        const size_t expected = counter + N_TASKS;
+        for (size_t i = 0; i < N_TASKS; ++i) {
+            pool.invoke([payload, &counter]() { counter += payload.size() ? 1 : 0; });
+        }
+        while (counter < expected) {
+            std::this_thread::yield();
+        }
+    };
+
+    // warm up queues' storage
+    submitAndWait();
+
+    const size_t before = g_allocations;
+    submitAndWait();
+    return g_allocations - before;
+}
+
+TEST(UniqueFunctionTests, ThreadPoolDoesNotAllocatePerTask)
+{
+    ThreadPool pool(2);
+    pool.run();
+    EXPECT_EQ(0u, countPoolAllocations(pool));
+    pool.interrupt();
+}
+
+TEST(UniqueFunctionTests, ThreadPoolLockFreeDoesNotAllocatePerTask)
+{
+    ThreadPool::Options options;
+    options.queueBackend = ThreadPool::QueueBackend::LOCK_FREE;
+    ThreadPool pool(2, options);
+    pool.run();
+    EXPECT_EQ(0u, countPoolAllocations(pool));
+    pool.interrupt();
+}
+
+TEST(UniqueFunctionTests, ThreadPoolQueuedDoesNotAllocatePerTask)
+{
+    ThreadPoolQueued pool(2);
+    pool.run();
+    EXPECT_EQ(0u, countPoolAllocations(pool));
+    pool.interrupt();
+}
+
+TEST(UniqueFunctionTests, SubmitAllocatesSharedStateOnly)
+{
+    const size_t N_TASKS = 1'000;
+    ThreadPool pool(2);
+    pool.run();
+
+    // warm up queue's storage
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        pool.submit([i]() { return i; }).get();
+    }
+
+    size_t result = 0u;
+    const size_t before = g_allocations;
+    for (size_t i = 0; i < N_TASKS; ++i) {
+        result += pool.submit([i]() { return i; }).get();
+    }
+    const size_t after = g_allocations;
+
+    EXPECT_EQ(N_TASKS, after - before);
+    EXPECT_EQ(N_TASKS * (N_TASKS - 1) / 2, result);
+    pool.interrupt();
+}
+
+TEST(UniqueFunctionTests, TaskGraphRerunDoesNotAllocate)
+{
+    const size_t N_NODES = 64;
+    ThreadPool pool(2);
+    pool.run();
+
+    std::atomic<size_t> counter = 0;
+    TaskGraph graph;
+    const auto root = graph.addNode([&counter]() { ++counter; });
+    for (size_t i = 1; i < N_NODES; ++i) {
+        graph.addEdge(root, graph.addNode([&counter]() { ++counter; }));
+    }
+
+    // builds internal structures and warms up queue's storage
+    graph.run(pool);
+
+    const size_t before = g_allocations;
+    for (size_t i = 0; i < 100; ++i) {
+        graph.run(pool);
+    }
+    const size_t after = g_allocations;
+
+    EXPECT_EQ(before, after);
+    EXPECT_EQ(101 * N_NODES, counter);
+    pool.interrupt();
+}